@@ -15,7 +15,8 @@ def midi_to_text(midi_file_path, output_text_file):
         current_ticks = 0
         for msg in track:
             current_ticks += msg.time
-            if not msg.is_meta:
+            # Los set_tempo se conservan para construir el mapa de tempo
+            if not msg.is_meta or msg.type == 'set_tempo':
                 all_events.append((current_ticks, i, msg))
 
     # Ordenar todos los eventos por tiempo acumulado
@@ -34,6 +35,8 @@ def midi_to_text(midi_file_path, output_text_file):
         for time, track_index, msg in all_events:
             if msg.type in ['note_on', 'note_off']:
                 file.write(f"Time={time} Track={track_index} {msg}\n")
+            elif msg.type == 'set_tempo':
+                file.write(f"Time={time} Track={track_index} set_tempo tempo={msg.tempo}\n")
 
 if __name__ == "__main__":
     if len(sys.argv) != 3:
@@ -53,21 +53,15 @@ fi
 cd "$HOME/Escritorio/tfg/tfg" || exit
 
 # EKSTRACCION MIDI
-echo "[*] EKSTRACCION MIDI"
-python3 ./decoder/midiXtractor.py "$MIDI_FILE" ./decoder/"$CRIM_FILE"
-
-if [ -f ./decoder/"$CRIM_FILE".crim2s ]; then
-    echo "Extracción completada."
-else
-    echo "Error: la extracción no generó los archivos esperados."
-    exit 1
-fi
+# Ya no se genera el .crim2s: el visor lee el .mid directamente con el lector SMF en C++.
+# La canción preprocesada se guarda en la caché (~/.cache/koloreo o $KOLOREO_CACHE_DIR),
+# así que las siguientes ejecuciones con el mismo .mid no vuelven a analizarlo.
+echo "[*] EKSTRACCION MIDI (integrada en el visor)"
 
 # KOMPILADO C++
 echo "[*] KOMPILADO C++"
-# Compilación y enlace con RtMidi
-g++ -I./recursos/rtmidi -c -o ./recursos/midiviewer.o ./recursos/plotNotasQT.cpp
-g++ ./recursos/midiviewer.o -o ./recursos/midiviewer -lsfml-graphics -lsfml-window -lsfml-system -lrtmidi -pthread
+# Usar Makefile para compilar (enlaza el cargador compartido de .crim2s)
+make -C ./recursos/daw_visualitation
 
 # Verificar si la compilación fue exitosa
 if [ $? -eq 0 ]; then
@@ -79,10 +73,10 @@ fi
 
 # PLOTTEO
 echo "[*] PLOTTEO"
-if [ -f "./recursos/midiviewer" ]; then
-    ./recursos/midiviewer ./decoder/"$CRIM_FILE".crim2s $BPM # Pasar el archivo .crim2s como argumento
+if [ -f "./recursos/daw_visualitation/midiviewer" ]; then
+    ./recursos/daw_visualitation/midiviewer "$MIDI_FILE" $BPM # Pasar el archivo .mid como argumento
 else
-    echo "Error: archivo ./recursos/midiviewer no encontrado."
+    echo "Error: archivo ./recursos/daw_visualitation/midiviewer no encontrado."
     exit 1
 fi
 
@@ -53,34 +53,35 @@ fi
 cd "$HOME/Escritorio/tfg/tfg" || exit
 
 # EKSTRACCION MIDI
-echo "[*] EKSTRACCION MIDI"
-python3 ./decoder/midiXtractor.py "$MIDI_FILE" ./decoder/"$CRIM_FILE"
-
-if [ -f ./decoder/"$CRIM_FILE".crim2s ]; then
-    echo "Extracción completada."
-else
-    echo "Error: la extracción no generó los archivos esperados."
-    exit 1
-fi
+# Ya no se genera el .crim2s: el visor lee el .mid directamente con el lector SMF en C++.
+# La canción preprocesada se guarda en la caché (~/.cache/koloreo o $KOLOREO_CACHE_DIR),
+# así que las siguientes ejecuciones con el mismo .mid no vuelven a analizarlo.
+echo "[*] EKSTRACCION MIDI (integrada en el visor)"
 
 # KOMPILADO C++
 echo "[*] KOMPILADO C++"
 # Compilación y enlace con RtMidi
-g++ -I./recursos/rtmidi -c -o ./recursos/midiviewer.o ./recursos/midiKaleidoskope.cpp
-g++ ./recursos/midiviewer.o -o ./recursos/midiviewer -lsfml-graphics -lsfml-window -lsfml-system -lrtmidi -pthread
-
-# Verificar si la compilación fue exitosa
-if [ $? -eq 0 ]; then
-    echo "Compilación exitosa."
-else
-    echo "Error: falló la compilación del programa."
+# El cargador primero: si falla, no se sigue con un midiviewer viejo
+make -C ./recursos/crim2sLoader libcrim2sLoader.a || {
+    echo "Error: falló la compilación del cargador (libcrim2sLoader.a)."
     exit 1
+}
+# Solo se recompila si el fuente o el cargador son más recientes que el ejecutable
+# (mismas opciones que los Makefile de cada visor)
+if [ ! -f ./recursos/midiviewer ] || [ ./recursos/midiKaleidoskope.cpp -nt ./recursos/midiviewer ] \
+   || [ ./recursos/crim2sLoader/libcrim2sLoader.a -nt ./recursos/midiviewer ]; then
+    if ! { g++ -std=c++17 -Wall -O2 -I./recursos/rtmidi -c -o ./recursos/midiviewer.o ./recursos/midiKaleidoskope.cpp &&
+           g++ ./recursos/midiviewer.o ./recursos/crim2sLoader/libcrim2sLoader.a -o ./recursos/midiviewer -lsfml-graphics -lsfml-window -lsfml-system -lrtmidi -pthread; }; then
+        echo "Error: falló la compilación del programa."
+        exit 1
+    fi
 fi
+echo "Compilación exitosa."
 
 # PLOTTEO
 echo "[*] PLOTTEO"
 if [ -f "./recursos/midiviewer" ]; then
-    ./recursos/midiviewer ./decoder/"$CRIM_FILE".crim2s $BPM # Pasar el archivo .crim2s como argumento
+    ./recursos/midiviewer "$MIDI_FILE" $BPM # Pasar el archivo .mid como argumento
 else
     echo "Error: archivo ./recursos/midiviewer no encontrado."
     exit 1
@@ -61,26 +61,25 @@ fi
 cd "$HOME/Escritorio/tfg/tfg" || exit
 
 # EKSTRACCION MIDI
-echo "[*] EKSTRACCION MIDI"
-python3 ./decoder/midiXtractor.py "$MIDI_FILE" "./decoder/$CRIM_FILE"
-
-if [ -f "./decoder/$CRIM_FILE.crim2s" ]; then
-    echo "Extracción completada."
-else
-    echo "Error: la extracción no generó los archivos esperados."
-    exit 1
-fi
+# Ya no se genera el .crim2s: el visor lee el .mid directamente con el lector SMF en C++.
+# La canción preprocesada se guarda en la caché (~/.cache/koloreo o $KOLOREO_CACHE_DIR),
+# así que las siguientes ejecuciones con el mismo .mid no vuelven a analizarlo.
+echo "[*] EKSTRACCION MIDI (integrada en el visor)"
 
 # KOMPILADO C++
 echo "[*] KOMPILADO C++"
 # Usar Makefile para compilar
-make -C ./recursos/transversal clean  # Limpiar compilaciones previas
-make -C ./recursos/transversal CRIM_FILE="$CRIM_FILE" BPM="$BPM" MIX_STRATEGY="$MIX_STRATEGY" run  # Compilar y ejecutar
+# Compilación incremental: solo se recompila lo que ha cambiado. Si falla, no se
+# sigue con un midiviewer viejo
+make -C ./recursos/transversal || {
+    echo "Error: falló la compilación del visor."
+    exit 1
+}
 
 # PLOTTEO
 echo "[*] PLOTTEO"
 if [ -f "./recursos/transversal/midiviewer" ]; then
-    ./recursos/transversal/midiviewer "./decoder/$CRIM_FILE.crim2s" "$BPM" "$MIX_STRATEGY" # Pasar el archivo .crim2s y la estrategia de mezcla como argumentos
+    ./recursos/transversal/midiviewer "$MIDI_FILE" "$BPM" "$MIX_STRATEGY" # Pasar el archivo .mid y la estrategia de mezcla como argumentos
 else
     echo "Error: archivo ./recursos/transversal/midiviewer no encontrado."
     exit 1
@@ -0,0 +1,36 @@
+// commandLine.cpp
+
+#include "commandLine.h"
+#include <algorithm>
+
+namespace {
+
+// Quita count argumentos a partir de la posición i
+void removeArguments(int& argc, char* argv[], int i, int count) {
+    std::copy(argv + i + count, argv + argc, argv + i);
+    argc -= count;
+    argv[argc] = nullptr;
+}
+
+} // namespace
+
+bool takeFlag(int& argc, char* argv[], const std::string& flag) {
+    for (int i = 1; i < argc; ++i) {
+        if (flag == argv[i]) {
+            removeArguments(argc, argv, i, 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool takeOption(int& argc, char* argv[], const std::string& flag, std::string& value) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (flag == argv[i]) {
+            value = argv[i + 1];
+            removeArguments(argc, argv, i, 2);
+            return true;
+        }
+    }
+    return false;
+}
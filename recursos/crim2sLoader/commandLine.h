@@ -0,0 +1,13 @@
+// commandLine.h
+
+#pragma once
+#include <string>
+
+// Opciones con nombre que los visores aceptan en cualquier posición. Se quitan de
+// argv (ajustando argc) para que el resto de argumentos siga en su sitio.
+
+// Quita flag de argv si aparece e indica si estaba
+bool takeFlag(int& argc, char* argv[], const std::string& flag);
+
+// Quita "flag valor" de argv si aparece y deja el valor en value
+bool takeOption(int& argc, char* argv[], const std::string& flag, std::string& value);
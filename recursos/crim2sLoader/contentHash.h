@@ -0,0 +1,43 @@
+// contentHash.h
+//
+// Hash rápido (no criptográfico) para identificar contenidos: clave de la caché
+// de canciones y checksum de los .crim2b
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+const std::uint64_t HASH_SEED = 14695981039346656037ull; // Base de FNV-1a
+const std::uint64_t HASH_PRIME = 1099511628211ull;
+
+// Variante de FNV-1a sobre palabras de 64 bits en cuatro carriles independientes,
+// para no quedar limitado por la latencia de la multiplicación byte a byte
+inline std::uint64_t contentHash(const void* data, std::size_t size, std::uint64_t seed = HASH_SEED) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    std::uint64_t lane[4] = {seed, seed ^ 0x9E3779B97F4A7C15ull, seed ^ 0xC2B2AE3D27D4EB4Full, seed ^ 0x165667B19E3779F9ull};
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int k = 0; k < 4; ++k) {
+            std::uint64_t word;
+            std::memcpy(&word, p + i + 8 * k, sizeof(word));
+            lane[k] = (lane[k] ^ word) * HASH_PRIME;
+            lane[k] ^= lane[k] >> 29;
+        }
+    }
+
+    std::uint64_t hash = seed ^ size;
+    for (int k = 0; k < 4; ++k) {
+        hash = (hash ^ lane[k]) * HASH_PRIME;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ p[i]) * HASH_PRIME;
+    }
+    return hash;
+}
+
+// Pliega un hash de 64 bits a 32 (para campos de cabecera de 32 bits)
+inline std::uint32_t foldHash32(std::uint64_t hash) {
+    return static_cast<std::uint32_t>(hash ^ (hash >> 32));
+}
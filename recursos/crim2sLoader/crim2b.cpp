@@ -0,0 +1,188 @@
+// crim2b.cpp
+
+#include "crim2b.h"
+#include "contentHash.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+std::uint64_t alignTo8(std::uint64_t offset) {
+    return (offset + 7) & ~static_cast<std::uint64_t>(7);
+}
+
+// Bytes que ocupan las columnas de una pista de n notas
+std::uint64_t columnBytes(std::uint64_t n) {
+    return n * (2 * sizeof(std::int32_t) + 3 * sizeof(std::uint8_t));
+}
+
+} // namespace
+
+bool Crim2bSong::open(const std::string& filename) {
+    header = nullptr;
+    tempo.clear();
+    tracks.clear();
+    if (!file.open(filename)) {
+        return false;
+    }
+
+    const char* base = file.begin();
+    std::uint64_t size = file.size();
+    if (size < sizeof(Crim2bHeader)) {
+        return false;
+    }
+    const Crim2bHeader* h = reinterpret_cast<const Crim2bHeader*>(base);
+    if (std::memcmp(h->magic, CRIM2B_MAGIC, 4) != 0 || h->version == 0 || h->version > CRIM2B_VERSION) {
+        return false;
+    }
+
+    std::uint64_t tempoOffset = sizeof(Crim2bHeader);
+    std::uint64_t entriesOffset = tempoOffset + std::uint64_t(h->tempoCount) * sizeof(TempoEvent);
+    std::uint64_t entriesEnd = entriesOffset + std::uint64_t(h->trackCount) * sizeof(Crim2bTrackEntry);
+    if (entriesEnd > size) {
+        return false;
+    }
+
+    tempo.resize(h->tempoCount);
+    if (h->tempoCount > 0) {
+        std::memcpy(tempo.data(), base + tempoOffset, h->tempoCount * sizeof(TempoEvent));
+    }
+
+    const Crim2bTrackEntry* entries = reinterpret_cast<const Crim2bTrackEntry*>(base + entriesOffset);
+    tracks.resize(h->trackCount);
+    for (std::uint32_t i = 0; i < h->trackCount; ++i) {
+        std::uint64_t offset = entries[i].offset;
+        std::uint64_t n = entries[i].noteCount;
+        if (offset % 8 != 0 || offset > size || columnBytes(n) > size - offset) {
+            tracks.clear();
+            tempo.clear();
+            return false;
+        }
+        const char* column = base + offset;
+        TrackColumns& t = tracks[i];
+        t.count = n;
+        t.startTick = reinterpret_cast<const std::int32_t*>(column);
+        t.endTick = t.startTick + n;
+        t.pitch = reinterpret_cast<const std::uint8_t*>(t.endTick + n);
+        t.velocity = t.pitch + n;
+        t.channel = t.velocity + n;
+    }
+
+    header = h;
+    return true;
+}
+
+bool Crim2bSong::verifyChecksum() const {
+    if (header == nullptr || header->version < CRIM2B_FIRST_CHECKSUM_VERSION) {
+        return false;
+    }
+    std::uint64_t hash = contentHash(file.begin() + sizeof(Crim2bHeader), file.size() - sizeof(Crim2bHeader));
+    return foldHash32(hash) == header->checksum;
+}
+
+std::vector<Track> Crim2bSong::toTracks() const {
+    std::vector<Track> result(tracks.size());
+    for (std::size_t i = 0; i < tracks.size(); ++i) {
+        const TrackColumns& columns = tracks[i];
+        result[i].notes.reserve(columns.size());
+        for (std::size_t j = 0; j < columns.size(); ++j) {
+            result[i].notes.push_back(columns[j]);
+        }
+    }
+    return result;
+}
+
+// Escribe las pistas (ya emparejadas) en formato .crim2b
+bool writeCrim2bFile(const std::string& filename, const std::vector<Track>& tracks, int ticksPerBeat,
+                     const std::vector<TempoEvent>& tempoMap) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error al crear el archivo " << filename << std::endl;
+        return false;
+    }
+
+    Crim2bHeader header;
+    std::memcpy(header.magic, CRIM2B_MAGIC, 4);
+    header.version = CRIM2B_VERSION;
+    header.ticksPerBeat = ticksPerBeat;
+    header.trackCount = static_cast<std::uint32_t>(tracks.size());
+    header.tempoCount = static_cast<std::uint32_t>(tempoMap.size());
+    header.checksum = 0; // Se reescribe al final
+
+    // Calcular la posición de las columnas de cada pista
+    std::vector<Crim2bTrackEntry> entries(tracks.size());
+    std::uint64_t offset = sizeof(Crim2bHeader) + tempoMap.size() * sizeof(TempoEvent)
+                         + tracks.size() * sizeof(Crim2bTrackEntry);
+    for (std::size_t i = 0; i < tracks.size(); ++i) {
+        offset = alignTo8(offset);
+        entries[i].offset = offset;
+        entries[i].noteCount = static_cast<std::uint32_t>(tracks[i].notes.size());
+        entries[i].reserved = 0;
+        offset += columnBytes(tracks[i].notes.size());
+    }
+
+    auto write = [&](const void* data, std::size_t size) {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!tempoMap.empty()) {
+        write(tempoMap.data(), tempoMap.size() * sizeof(TempoEvent));
+    }
+    if (!entries.empty()) {
+        write(entries.data(), entries.size() * sizeof(Crim2bTrackEntry));
+    }
+
+    // Escribir las columnas de cada pista
+    std::vector<std::int32_t> ticks;
+    std::vector<std::uint8_t> bytes;
+    for (std::size_t i = 0; i < tracks.size(); ++i) {
+        static const char padding[8] = {0};
+        std::uint64_t position = static_cast<std::uint64_t>(out.tellp());
+        write(padding, static_cast<std::size_t>(entries[i].offset - position));
+
+        const std::vector<NoteEvent>& notes = tracks[i].notes;
+        std::size_t n = notes.size();
+        ticks.resize(2 * n);
+        bytes.resize(3 * n);
+        for (std::size_t j = 0; j < n; ++j) {
+            ticks[j] = notes[j].startTime;
+            ticks[n + j] = notes[j].endTime;
+            bytes[j] = static_cast<std::uint8_t>(notes[j].note);
+            bytes[n + j] = static_cast<std::uint8_t>(notes[j].velocity);
+            bytes[2 * n + j] = static_cast<std::uint8_t>(notes[j].channel);
+        }
+        write(ticks.data(), ticks.size() * sizeof(std::int32_t));
+        write(bytes.data(), bytes.size());
+    }
+
+    // El checksum cubre todo lo que sigue a la cabecera: se calcula sobre el archivo
+    // ya escrito y se reescribe la cabecera
+    out.flush();
+    MappedFile written;
+    if (!out || !written.open(filename) || written.size() < sizeof(Crim2bHeader)) {
+        std::cerr << "Error al escribir el archivo " << filename << std::endl;
+        return false;
+    }
+    header.checksum = foldHash32(contentHash(written.begin() + sizeof(Crim2bHeader), written.size() - sizeof(Crim2bHeader)));
+    written.close();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    return static_cast<bool>(out);
+}
+
+// Lee un .crim2b y devuelve las pistas, igual que readCrim2sFile
+std::vector<Track> readCrim2bFile(const std::string& filename, int& ticksPerBeat,
+                                  std::vector<TempoEvent>* tempoMap) {
+    Crim2bSong song;
+    if (!song.open(filename)) {
+        std::cerr << "Error al abrir el archivo " << filename << " (no es un .crim2b válido)" << std::endl;
+        return {};
+    }
+    ticksPerBeat = song.ticksPerBeat();
+    if (tempoMap) {
+        *tempoMap = song.tempoMap();
+    }
+    return song.toTracks();
+}
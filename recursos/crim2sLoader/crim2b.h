@@ -0,0 +1,93 @@
+// crim2b.h
+
+#pragma once
+#include "crim2sLoader.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Formato binario .crim2b (little-endian):
+//
+//   Crim2bHeader
+//   TempoEvent            tempo[tempoCount]
+//   Crim2bTrackEntry      tracks[trackCount]
+//   por cada pista, en su offset (alineado a 8 bytes) y en columnas:
+//     int32 startTick[n], int32 endTick[n], uint8 pitch[n], uint8 velocity[n], uint8 channel[n]
+//
+// Las notas ya están emparejadas, así que cargar no requiere ningún análisis.
+// Desde la versión 2 la cabecera lleva un checksum de todo lo que la sigue.
+
+const char CRIM2B_MAGIC[4] = {'C', 'R', '2', 'B'};
+const std::uint32_t CRIM2B_VERSION = 2;
+const std::uint32_t CRIM2B_FIRST_CHECKSUM_VERSION = 2;
+
+struct Crim2bHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::int32_t ticksPerBeat;
+    std::uint32_t trackCount;
+    std::uint32_t tempoCount;
+    std::uint32_t checksum; // FNV-1a plegado a 32 bits de los bytes tras la cabecera (0 en la versión 1)
+};
+
+struct Crim2bTrackEntry {
+    std::uint64_t offset;    // Desde el inicio del archivo
+    std::uint32_t noteCount;
+    std::uint32_t reserved;
+};
+
+// Vista de una pista sobre las columnas proyectadas en memoria
+struct TrackColumns {
+    const std::int32_t* startTick = nullptr;
+    const std::int32_t* endTick = nullptr;
+    const std::uint8_t* pitch = nullptr;
+    const std::uint8_t* velocity = nullptr;
+    const std::uint8_t* channel = nullptr;
+    std::size_t count = 0;
+
+    std::size_t size() const { return count; }
+
+    // Construye el NoteEvent i-ésimo leyendo directamente de las columnas
+    NoteEvent operator[](std::size_t i) const {
+        NoteEvent event;
+        event.note = pitch[i];
+        event.startTime = startTick[i];
+        event.endTime = endTick[i];
+        event.channel = channel[i];
+        event.velocity = velocity[i];
+        return event;
+    }
+};
+
+// Canción .crim2b proyectada en memoria. Las columnas siguen siendo válidas
+// mientras el objeto exista.
+class Crim2bSong {
+public:
+    // Proyecta y valida el archivo; devuelve false si no es un .crim2b válido
+    bool open(const std::string& filename);
+
+    int ticksPerBeat() const { return header ? header->ticksPerBeat : 480; }
+    std::size_t trackCount() const { return tracks.size(); }
+    const TrackColumns& track(std::size_t i) const { return tracks[i]; }
+    const std::vector<TempoEvent>& tempoMap() const { return tempo; }
+
+    // Copia las columnas a pistas editables (para los visores que marcan noteOnSent)
+    std::vector<Track> toTracks() const;
+
+    // Recorre el archivo completo y comprueba el checksum (false en la versión 1)
+    bool verifyChecksum() const;
+
+private:
+    MappedFile file;
+    const Crim2bHeader* header = nullptr;
+    std::vector<TempoEvent> tempo;
+    std::vector<TrackColumns> tracks;
+};
+
+// Escribe las pistas (ya emparejadas) en formato .crim2b
+bool writeCrim2bFile(const std::string& filename, const std::vector<Track>& tracks, int ticksPerBeat,
+                     const std::vector<TempoEvent>& tempoMap);
+
+// Lee un .crim2b y devuelve las pistas, igual que readCrim2sFile
+std::vector<Track> readCrim2bFile(const std::string& filename, int& ticksPerBeat,
+                                  std::vector<TempoEvent>* tempoMap = nullptr);
@@ -0,0 +1,427 @@
+// crim2sLoader.cpp
+
+#include "crim2sLoader.h"
+#include "crim2sParse.h"
+#include "parseDiagnostics.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// -------------------------- MappedFile --------------------------
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filename) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        // Un archivo vacío es válido, simplemente no tiene contenido
+        ::close(fd);
+        return true;
+    }
+    void* mapped = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // La proyección sigue siendo válida tras cerrar el descriptor
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    madvise(mapped, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+    data = static_cast<const char*>(mapped);
+    length = static_cast<std::size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::release(const char* upTo) {
+    if (data == nullptr || upTo <= data) {
+        return;
+    }
+    std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::size_t bytes = std::min(static_cast<std::size_t>(upTo - data), length) / pageSize * pageSize;
+    if (bytes > 0) {
+        // La proyección es de solo lectura: las páginas se vuelven a leer del archivo si hace falta
+        madvise(const_cast<char*>(data), bytes, MADV_DONTNEED);
+    }
+}
+
+void MappedFile::close() {
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), length);
+    }
+    data = nullptr;
+    length = 0;
+}
+
+// -------------------------- NotePairer --------------------------
+
+namespace {
+const int PAIRING_SLOTS = 16 * 128; // 16 canales x 128 notas
+}
+
+NotePairer::NotePairer(std::vector<Track>& tracks, NoteOffPairing pairing)
+    : tracks(tracks), pairing(pairing),
+      head(tracks.size(), std::vector<int>(PAIRING_SLOTS, -1)),
+      tail(tracks.size(), std::vector<int>(PAIRING_SLOTS, -1)),
+      nextOpen(tracks.size()) {}
+
+void NotePairer::noteOn(int trackIndex, int channel, int note, int velocity, int time) {
+    std::vector<NoteEvent>& notes = tracks[trackIndex].notes;
+    int index = static_cast<int>(notes.size());
+
+    NoteEvent newNote;
+    newNote.note = note;
+    newNote.startTime = time;
+    newNote.endTime = -1;
+    newNote.channel = channel;
+    newNote.velocity = velocity;
+    notes.push_back(newNote);
+
+    std::vector<int>& next = nextOpen[trackIndex];
+    next.push_back(-1);
+
+    int s = slot(channel, note);
+    int& first = head[trackIndex][s];
+    int& last = tail[trackIndex][s];
+    if (first == -1) {
+        first = last = index;
+    } else if (pairing == NoteOffPairing::FIFO) {
+        // Se añade al final: el note_off cerrará la más antigua
+        next[last] = index;
+        last = index;
+    } else {
+        // Se añade al principio: el note_off cerrará la más reciente
+        next[index] = first;
+        first = index;
+    }
+}
+
+bool NotePairer::noteOff(int trackIndex, int channel, int note, int time) {
+    int s = slot(channel, note);
+    int& first = head[trackIndex][s];
+    if (first == -1) {
+        return false;
+    }
+    int index = first;
+    first = nextOpen[trackIndex][index];
+    if (first == -1) {
+        tail[trackIndex][s] = -1;
+    }
+    tracks[trackIndex].notes[index].endTime = time;
+    return true;
+}
+
+void NotePairer::finish() {
+    int maxTime = 0;
+    for (const auto& track : tracks) {
+        for (const auto& note : track.notes) {
+            if (note.endTime > maxTime) {
+                maxTime = note.endTime;
+            }
+        }
+    }
+    for (auto& track : tracks) {
+        for (auto& note : track.notes) {
+            if (note.endTime == -1) {
+                // Nunca antes de su propio note_on, o la nota no se apagaría
+                note.endTime = std::max(maxTime, note.startTime);
+            }
+        }
+    }
+}
+
+// -------------------------- Lector .crim2s --------------------------
+
+// Ordena los cambios de tempo por tick conservando el orden de archivo en empates
+void sortTempoMap(std::vector<TempoEvent>& tempoMap) {
+    std::stable_sort(tempoMap.begin(), tempoMap.end(),
+                     [](const TempoEvent& a, const TempoEvent& b) { return a.tick < b.tick; });
+}
+
+namespace {
+
+// Texto de la línea que empieza en p (sin el salto de línea)
+std::string_view lineAt(const char* p, const char* end) {
+    const char* next = p;
+    const char* eol = lineEnd(p, end, next);
+    return std::string_view(p, static_cast<std::size_t>(eol - p));
+}
+
+} // namespace
+
+// Lee el archivo .crim2s y devuelve las pistas
+std::vector<Track> readCrim2sFile(const std::string& filename, int& ticksPerBeat,
+                                  NoteOffPairing pairing, std::vector<TempoEvent>* tempoMap,
+                                  ParseDiagnostics* diagnostics) {
+    std::vector<Track> tracks;
+    if (tempoMap) {
+        tempoMap->clear();
+    }
+    MappedFile file;
+    if (!file.open(filename)) {
+        std::cerr << "Error al abrir el archivo " << filename << std::endl;
+        return tracks;
+    }
+
+    // Sin contabilidad externa, el resumen se escribe al terminar
+    ParseDiagnostics localDiagnostics;
+    ParseDiagnostics& issues = diagnostics ? *diagnostics : localDiagnostics;
+
+    const char* begin = file.begin();
+    const char* end = file.end();
+    int totalTracks = 0;
+    const char* p = parseHeader(begin, end, ticksPerBeat, totalTracks);
+    tracks.resize(totalTracks > 0 ? totalTracks : 0);
+
+    // Leer los eventos directamente sobre la proyección, sin copiar líneas
+    NotePairer pairer(tracks, pairing);
+    const char* next = p;
+    while (p < end) {
+        const char* eol = lineEnd(p, end, next);
+        ParsedEvent event;
+        bool valid = parseEventLine(p, eol, event);
+        const char* line = p;
+        p = next;
+        if (!valid) {
+            TempoEvent tempo;
+            if (parseTempoLine(line, eol, tempo.tick, tempo.microsecondsPerBeat)) {
+                if (tempoMap) {
+                    tempoMap->push_back(tempo);
+                }
+            } else if (eol > line && !isIgnoredEventLine(line, eol)) {
+                issues.report(ParseIssue::MalformedLine, line - begin, std::string_view(line, eol - line));
+            }
+            continue;
+        }
+
+        if (event.trackIndex < 0 || event.trackIndex >= totalTracks) {
+            issues.report(ParseIssue::InvalidTrack, line - begin, std::string_view(line, eol - line));
+            continue;
+        }
+
+        if (event.noteOn) {
+            pairer.noteOn(event.trackIndex, event.channel, event.note, event.velocity, event.time);
+        } else if (!pairer.noteOff(event.trackIndex, event.channel, event.note, event.time)) {
+            issues.report(ParseIssue::UnmatchedNoteOff, line - begin, std::string_view(line, eol - line));
+        }
+    }
+
+    // Establecer endTime para notas que no lo tienen
+    pairer.finish();
+
+    if (tempoMap) {
+        sortTempoMap(*tempoMap);
+    }
+    if (!diagnostics) {
+        localDiagnostics.printSummary(std::cerr, filename);
+    }
+    return tracks;
+}
+
+// -------------------------- Lector .crim2s en paralelo --------------------------
+
+namespace {
+
+// Por debajo de este tamaño de sección de eventos no compensa repartir el trabajo
+const std::size_t PARALLEL_MIN_BYTES = 4 << 20;
+
+// Tamaño máximo de un bloque, para que las posiciones quepan en 32 bits
+const std::size_t MAX_CHUNK_BYTES = std::size_t(1) << 31;
+
+// Evento de una pista dentro de un bloque, con la posición de su línea para los avisos
+struct ChunkEvent {
+    int time;
+    int channel;
+    int note;
+    int velocity;
+    bool noteOn;
+    std::uint32_t offset; // Desde el inicio del bloque
+};
+
+// Resultado de analizar un bloque de líneas
+struct ChunkResult {
+    std::vector<std::vector<ChunkEvent>> perTrack;
+    std::vector<std::uint32_t> invalidTracks;  // Posiciones de líneas con índice de pista inválido
+    std::vector<std::uint32_t> malformedLines; // Posiciones de líneas no reconocidas
+    std::vector<TempoEvent> tempo;
+};
+
+// Aviso diferido; se ordenan por su posición en el archivo
+struct PendingWarning {
+    const char* line;
+    ParseIssue issue;
+};
+
+void parseChunk(const char* p, const char* end, int totalTracks, ChunkResult& result) {
+    result.perTrack.assign(static_cast<std::size_t>(totalTracks), {});
+    const char* start = p;
+    const char* next = p;
+    while (p < end) {
+        const char* eol = lineEnd(p, end, next);
+        ParsedEvent event;
+        bool valid = parseEventLine(p, eol, event);
+        const char* line = p;
+        p = next;
+        std::uint32_t offset = static_cast<std::uint32_t>(line - start);
+        if (!valid) {
+            TempoEvent tempo;
+            if (parseTempoLine(line, eol, tempo.tick, tempo.microsecondsPerBeat)) {
+                result.tempo.push_back(tempo);
+            } else if (eol > line && !isIgnoredEventLine(line, eol)) {
+                result.malformedLines.push_back(offset);
+            }
+            continue;
+        }
+
+        if (event.trackIndex < 0 || event.trackIndex >= totalTracks) {
+            result.invalidTracks.push_back(offset);
+            continue;
+        }
+        result.perTrack[event.trackIndex].push_back(
+            {event.time, event.channel, event.note, event.velocity, event.noteOn, offset});
+    }
+}
+
+// Ejecuta work(i) para i en [0, count) repartido entre threadCount hilos
+template <typename Work>
+void runOnPool(std::size_t count, unsigned threadCount, Work work) {
+    std::atomic<std::size_t> nextItem(0);
+    auto worker = [&]() {
+        for (std::size_t i = nextItem++; i < count; i = nextItem++) {
+            work(i);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threadCount; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+} // namespace
+
+// Igual que readCrim2sFile pero analiza la sección de eventos en paralelo
+std::vector<Track> readCrim2sFileParallel(const std::string& filename, int& ticksPerBeat,
+                                          NoteOffPairing pairing, unsigned threadCount,
+                                          std::vector<TempoEvent>* tempoMap,
+                                          ParseDiagnostics* diagnostics) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        std::cerr << "Error al abrir el archivo " << filename << std::endl;
+        return {};
+    }
+
+    const char* begin = file.begin();
+    const char* end = file.end();
+    int totalTracks = 0;
+    const char* body = parseHeader(begin, end, ticksPerBeat, totalTracks);
+    std::size_t bodySize = static_cast<std::size_t>(end - body);
+
+    bool automatic = threadCount == 0;
+    if (automatic) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (threadCount == 1 || (automatic && bodySize < PARALLEL_MIN_BYTES)) {
+        file.close();
+        return readCrim2sFile(filename, ticksPerBeat, pairing, tempoMap, diagnostics);
+    }
+
+    std::vector<Track> tracks(totalTracks > 0 ? totalTracks : 0);
+
+    // 1. Cortar la sección de eventos en bloques que terminan en un salto de línea
+    std::size_t chunkCount = std::min<std::size_t>(threadCount * 4, std::max<std::size_t>(1, bodySize / 4096));
+    chunkCount = std::max(chunkCount, bodySize / MAX_CHUNK_BYTES + 1);
+    std::vector<const char*> bounds(1, body);
+    for (std::size_t i = 1; i < chunkCount; ++i) {
+        const char* cut = body + bodySize * i / chunkCount;
+        cut = std::max(cut, bounds.back());
+        const char* nl = static_cast<const char*>(std::memchr(cut, '\n', static_cast<std::size_t>(end - cut)));
+        cut = nl ? nl + 1 : end;
+        if (cut > bounds.back() && cut < end) {
+            bounds.push_back(cut);
+        }
+    }
+    bounds.push_back(end);
+    chunkCount = bounds.size() - 1;
+
+    // 2. Analizar cada bloque en un hilo, separando los eventos por pista
+    std::vector<ChunkResult> chunks(chunkCount);
+    runOnPool(chunkCount, threadCount, [&](std::size_t i) {
+        parseChunk(bounds[i], bounds[i + 1], totalTracks, chunks[i]);
+    });
+
+    // 3. Emparejar cada pista recorriendo sus bloques en orden de archivo. Las pistas
+    //    son independientes, así que el resultado es idéntico al lector secuencial.
+    NotePairer pairer(tracks, pairing);
+    std::vector<std::vector<PendingWarning>> unmatched(tracks.size());
+    runOnPool(tracks.size(), threadCount, [&](std::size_t t) {
+        std::size_t total = 0;
+        for (const auto& chunk : chunks) {
+            total += chunk.perTrack[t].size();
+        }
+        tracks[t].notes.reserve(total);
+        int trackIndex = static_cast<int>(t);
+        for (std::size_t i = 0; i < chunkCount; ++i) {
+            for (const ChunkEvent& event : chunks[i].perTrack[t]) {
+                if (event.noteOn) {
+                    pairer.noteOn(trackIndex, event.channel, event.note, event.velocity, event.time);
+                } else if (!pairer.noteOff(trackIndex, event.channel, event.note, event.time)) {
+                    unmatched[t].push_back({bounds[i] + event.offset, ParseIssue::UnmatchedNoteOff});
+                }
+            }
+        }
+    });
+
+    // 4. Registrar los avisos en el mismo orden que el lector secuencial
+    std::vector<PendingWarning> warnings;
+    for (std::size_t i = 0; i < chunkCount; ++i) {
+        for (std::uint32_t offset : chunks[i].invalidTracks) {
+            warnings.push_back({bounds[i] + offset, ParseIssue::InvalidTrack});
+        }
+        for (std::uint32_t offset : chunks[i].malformedLines) {
+            warnings.push_back({bounds[i] + offset, ParseIssue::MalformedLine});
+        }
+    }
+    for (const auto& trackWarnings : unmatched) {
+        warnings.insert(warnings.end(), trackWarnings.begin(), trackWarnings.end());
+    }
+    std::sort(warnings.begin(), warnings.end(),
+              [](const PendingWarning& a, const PendingWarning& b) { return a.line < b.line; });
+    ParseDiagnostics localDiagnostics;
+    ParseDiagnostics& issues = diagnostics ? *diagnostics : localDiagnostics;
+    for (const PendingWarning& warning : warnings) {
+        issues.report(warning.issue, warning.line - begin, lineAt(warning.line, end));
+    }
+
+    // Establecer endTime para notas que no lo tienen
+    pairer.finish();
+
+    if (tempoMap) {
+        tempoMap->clear();
+        for (const auto& chunk : chunks) {
+            tempoMap->insert(tempoMap->end(), chunk.tempo.begin(), chunk.tempo.end());
+        }
+        sortTempoMap(*tempoMap);
+    }
+    if (!diagnostics) {
+        localDiagnostics.printSummary(std::cerr, filename);
+    }
+    return tracks;
+}
@@ -0,0 +1,108 @@
+// crim2sLoader.h
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class ParseDiagnostics;
+
+// Estructura para representar un evento de nota
+struct NoteEvent {
+    int note;
+    int startTime;
+    int endTime;
+    int channel = 0;
+    int velocity = 64;
+    bool noteOnSent = false;
+    bool noteOffSent = false;
+};
+
+// Estructura para representar una pista
+struct Track {
+    std::vector<NoteEvent> notes;
+};
+
+// Cambio de tempo (set_tempo) en ticks absolutos
+struct TempoEvent {
+    int tick;
+    int microsecondsPerBeat;
+};
+
+// Criterio para emparejar un note_off con las notas abiertas de la misma altura
+enum class NoteOffPairing {
+    FIFO, // Cierra la nota abierta más antigua (comportamiento original)
+    LIFO  // Cierra la nota abierta más reciente
+};
+
+// Empareja note_on/note_off en tiempo constante. Mantiene, por cada
+// (pista, canal, nota), una lista enlazada de las notas aún abiertas.
+class NotePairer {
+public:
+    NotePairer(std::vector<Track>& tracks, NoteOffPairing pairing);
+
+    // Abre una nota nueva en la pista indicada
+    void noteOn(int trackIndex, int channel, int note, int velocity, int time);
+
+    // Cierra una nota abierta; devuelve false si no había ninguna
+    bool noteOff(int trackIndex, int channel, int note, int time);
+
+    // Establece endTime para notas que no lo tienen (el mayor endTime leído, o su
+    // inicio si empiezan después)
+    void finish();
+
+private:
+    static int slot(int channel, int note) { return (channel & 0x0F) * 128 + (note & 0x7F); }
+
+    std::vector<Track>& tracks;
+    NoteOffPairing pairing;
+    std::vector<std::vector<int>> head;     // Primera nota abierta de cada (canal, nota) por pista
+    std::vector<std::vector<int>> tail;     // Última nota abierta de cada (canal, nota) por pista
+    std::vector<std::vector<int>> nextOpen; // Siguiente nota abierta en la misma lista
+};
+
+// Archivo proyectado en memoria (solo lectura). Se libera al destruirse.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Proyecta el archivo completo; devuelve false si no se puede abrir
+    bool open(const std::string& filename);
+    void close();
+
+    const char* begin() const { return data; }
+    const char* end() const { return data + length; }
+    std::size_t size() const { return length; }
+
+    // Devuelve al sistema las páginas ya leídas anteriores a upTo (lectura en streaming)
+    void release(const char* upTo);
+
+private:
+    const char* data = nullptr;
+    std::size_t length = 0;
+};
+
+// Ordena los cambios de tempo por tick conservando el orden de archivo en empates
+void sortTempoMap(std::vector<TempoEvent>& tempoMap);
+
+// Lee el archivo .crim2s y devuelve las pistas. Si tempoMap no es nulo, se rellena
+// con las líneas set_tempo ordenadas por tick. Los problemas de lectura se cuentan en
+// diagnostics; si es nulo, se escribe un único resumen en std::cerr al terminar.
+std::vector<Track> readCrim2sFile(const std::string& filename, int& ticksPerBeat,
+                                  NoteOffPairing pairing = NoteOffPairing::FIFO,
+                                  std::vector<TempoEvent>* tempoMap = nullptr,
+                                  ParseDiagnostics* diagnostics = nullptr);
+
+// Igual que readCrim2sFile, pero corta la sección de eventos en bloques por saltos de
+// línea, los analiza en varios hilos y luego empareja cada pista en orden de archivo.
+// El resultado es idéntico al del lector secuencial. Con threadCount = 0 se usan todos
+// los núcleos y los archivos pequeños se leen de forma secuencial.
+std::vector<Track> readCrim2sFileParallel(const std::string& filename, int& ticksPerBeat,
+                                          NoteOffPairing pairing = NoteOffPairing::FIFO,
+                                          unsigned threadCount = 0,
+                                          std::vector<TempoEvent>* tempoMap = nullptr,
+                                          ParseDiagnostics* diagnostics = nullptr);
@@ -0,0 +1,156 @@
+// crim2sParse.h
+//
+// Escáner de texto .crim2s compartido por los lectores (uso interno del cargador)
+
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+// Lee un entero decimal (con signo opcional) y avanza el puntero
+inline bool scanInt(const char*& p, const char* end, int& value) {
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        ++p;
+    }
+    const char* digits = p;
+    int result = 0;
+    while (p < end && static_cast<unsigned>(*p - '0') < 10u) {
+        result = result * 10 + (*p - '0');
+        ++p;
+    }
+    if (p == digits) {
+        return false;
+    }
+    value = negative ? -result : result;
+    return true;
+}
+
+// Comprueba que el texto empieza por la clave indicada y la salta
+template <std::size_t N>
+inline bool skipKey(const char*& p, const char* end, const char (&key)[N]) {
+    constexpr std::size_t len = N - 1;
+    if (static_cast<std::size_t>(end - p) < len || std::memcmp(p, key, len) != 0) {
+        return false;
+    }
+    p += len;
+    return true;
+}
+
+inline void skipSpaces(const char*& p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        ++p;
+    }
+}
+
+// Devuelve el final de la línea actual (sin incluir '\n' ni '\r')
+inline const char* lineEnd(const char* p, const char* end, const char*& next) {
+    const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+    if (nl == nullptr) {
+        next = end;
+        nl = end;
+    } else {
+        next = nl + 1;
+    }
+    if (nl > p && nl[-1] == '\r') {
+        --nl;
+    }
+    return nl;
+}
+
+// Lee el entero que sigue a la etiqueta en una línea del encabezado
+inline bool scanHeaderValue(std::string_view line, std::string_view label, int& value) {
+    std::size_t pos = line.find(label);
+    if (pos == std::string_view::npos) {
+        return false;
+    }
+    const char* p = line.data() + pos + label.size();
+    const char* end = line.data() + line.size();
+    skipSpaces(p, end);
+    return scanInt(p, end, value);
+}
+
+// Evento note_on/note_off ya analizado
+struct ParsedEvent {
+    int time;
+    int trackIndex;
+    int channel;
+    int note;
+    int velocity;
+    bool noteOn; // note_on con velocidad > 0
+};
+
+// Analiza una línea de eventos; devuelve false si no es un note_on/note_off bien formado
+inline bool parseEventLine(const char* q, const char* eol, ParsedEvent& event) {
+    int velocity = 0;
+    if (!skipKey(q, eol, "Time=") || !scanInt(q, eol, event.time)) return false;
+    skipSpaces(q, eol);
+    if (!skipKey(q, eol, "Track=") || !scanInt(q, eol, event.trackIndex)) return false;
+    skipSpaces(q, eol);
+
+    // Tipo de mensaje: solo interesan note_on y note_off
+    const char* type = q;
+    while (q < eol && *q != ' ') ++q;
+    std::size_t typeLen = static_cast<std::size_t>(q - type);
+    bool isNoteOn = typeLen == 7 && std::memcmp(type, "note_on", 7) == 0;
+    bool isNoteOff = typeLen == 8 && std::memcmp(type, "note_off", 8) == 0;
+    if (!isNoteOn && !isNoteOff) return false;
+
+    skipSpaces(q, eol);
+    if (!skipKey(q, eol, "channel=") || !scanInt(q, eol, event.channel)) return false;
+    skipSpaces(q, eol);
+    if (!skipKey(q, eol, "note=") || !scanInt(q, eol, event.note)) return false;
+    skipSpaces(q, eol);
+    if (!skipKey(q, eol, "velocity=") || !scanInt(q, eol, velocity)) return false;
+
+    event.velocity = velocity;
+    event.noteOn = isNoteOn && velocity > 0;
+    return true;
+}
+
+// true si la línea es un evento bien formado de un tipo que no se usa (control_change,
+// program_change...). Sirve para no contar esas líneas como mal formadas.
+inline bool isIgnoredEventLine(const char* q, const char* eol) {
+    int value = 0;
+    if (!skipKey(q, eol, "Time=") || !scanInt(q, eol, value)) return false;
+    skipSpaces(q, eol);
+    if (!skipKey(q, eol, "Track=") || !scanInt(q, eol, value)) return false;
+    skipSpaces(q, eol);
+    const char* type = q;
+    while (q < eol && *q != ' ') ++q;
+    std::size_t typeLen = static_cast<std::size_t>(q - type);
+    if (typeLen == 0) return false;
+    return !(typeLen == 7 && std::memcmp(type, "note_on", 7) == 0)
+        && !(typeLen == 8 && std::memcmp(type, "note_off", 8) == 0);
+}
+
+// Analiza una línea "Time=T Track=N set_tempo tempo=U"; devuelve false si no lo es
+inline bool parseTempoLine(const char* q, const char* eol, int& time, int& microsecondsPerBeat) {
+    int trackIndex = 0;
+    if (!skipKey(q, eol, "Time=") || !scanInt(q, eol, time)) return false;
+    skipSpaces(q, eol);
+    if (!skipKey(q, eol, "Track=") || !scanInt(q, eol, trackIndex)) return false;
+    skipSpaces(q, eol);
+    if (!skipKey(q, eol, "set_tempo")) return false;
+    skipSpaces(q, eol);
+    return skipKey(q, eol, "tempo=") && scanInt(q, eol, microsecondsPerBeat) && microsecondsPerBeat > 0;
+}
+
+// Lee el encabezado y devuelve el inicio de la sección de eventos
+inline const char* parseHeader(const char* p, const char* end, int& ticksPerBeat, int& totalTracks) {
+    const char* next = p;
+    while (p < end) {
+        const char* eol = lineEnd(p, end, next);
+        std::string_view line(p, static_cast<std::size_t>(eol - p));
+        p = next;
+        if (scanHeaderValue(line, "Ticks per beat:", ticksPerBeat)) {
+            continue;
+        }
+        if (!scanHeaderValue(line, "Número de pistas:", totalTracks) &&
+            line.find("Eventos:") != std::string_view::npos) {
+            break;
+        }
+    }
+    return p;
+}
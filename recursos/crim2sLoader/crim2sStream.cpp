@@ -0,0 +1,227 @@
+// crim2sStream.cpp
+
+#include "crim2sStream.h"
+#include "crim2sParse.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+// Eventos que el hilo lector analiza antes de volver a comprobar la ventana
+const std::size_t BATCH_EVENTS = 256;
+
+// Cada cuántos bytes leídos se devuelven páginas al sistema
+const std::size_t RELEASE_BYTES = 1 << 20;
+
+// Con la cola llena, cada cuánto vuelve a mirar el lector (el hilo de envío no avisa)
+const std::chrono::milliseconds QUEUE_RETRY(1);
+
+} // namespace
+
+Crim2sStream::~Crim2sStream() {
+    close();
+}
+
+bool Crim2sStream::open(const std::string& filename, float windowBeats, std::size_t maxBufferedEvents) {
+    close();
+    if (!file.open(filename)) {
+        std::cerr << "Error al abrir el archivo " << filename << std::endl;
+        return false;
+    }
+
+    source = filename;
+    diagnostics.clear();
+    cursor = parseHeader(file.begin(), file.end(), ticks, tracks);
+    released = file.begin();
+    openNotes.assign(tracks, {});
+    window = windowBeats > 0 ? static_cast<int>(windowBeats * ticks) : 0;
+    maxBuffered = maxBufferedEvents > 0 ? maxBufferedEvents : 1;
+    reader = std::thread(&Crim2sStream::readerLoop, this);
+    return true;
+}
+
+void Crim2sStream::close() {
+    if (reader.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        canRead.notify_all();
+        reader.join();
+    }
+    file.close();
+    buffer.clear();
+    queue = nullptr;
+    cursor = released = nullptr;
+    consumerTick = lastTick = 0;
+    ready = done = stopping = false;
+}
+
+void Crim2sStream::waitReady() {
+    std::unique_lock<std::mutex> lock(mutex);
+    readyCond.wait(lock, [this] { return ready || !reader.joinable(); });
+}
+
+void Crim2sStream::poll(int uptoTick, std::vector<StreamEvent>& out) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!buffer.empty() && buffer.front().tick <= uptoTick) {
+            out.push_back(buffer.front());
+            buffer.pop_front();
+        }
+        if (uptoTick > consumerTick) {
+            consumerTick = uptoTick;
+        }
+    }
+    canRead.notify_one();
+}
+
+bool Crim2sStream::finished() {
+    if (queue != nullptr) {
+        return done;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    return done && buffer.empty();
+}
+
+void Crim2sStream::feed(StreamQueue& target) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue = &target;
+    }
+    // Lo ya leído pasa a la cola en la siguiente vuelta del lector
+    canRead.notify_one();
+}
+
+bool Crim2sStream::pushToQueue(const std::vector<StreamEvent>& events) {
+    for (const StreamEvent& event : events) {
+        while (!queue.load()->push(event)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!ready) {
+                ready = true;
+                readyCond.notify_all();
+            }
+            if (canRead.wait_for(lock, QUEUE_RETRY, [this] { return stopping; })) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool Crim2sStream::pairNote(const StreamEvent& event) {
+    std::vector<StreamEvent>& open = openNotes[event.track];
+    if (event.noteOn) {
+        open.push_back(event);
+        return true;
+    }
+    // Igual que el lector completo: el note_off cierra la nota abierta más antigua
+    for (auto it = open.begin(); it != open.end(); ++it) {
+        if (it->note == event.note && it->channel == event.channel) {
+            open.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Hilo lector: analiza lotes de líneas mientras la ventana tenga hueco
+void Crim2sStream::readerLoop() {
+    const char* end = file.end();
+    std::vector<StreamEvent> batch;
+    batch.reserve(BATCH_EVENTS);
+    std::vector<StreamEvent> outgoing; // Lo que pasa a la cola de feed() en esta vuelta
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto windowFull = [this] {
+                return queue == nullptr && (lastTick > consumerTick + window || buffer.size() >= maxBuffered);
+            };
+            if (windowFull() && !ready) {
+                ready = true;
+                readyCond.notify_all();
+            }
+            canRead.wait(lock, [&] { return stopping || !windowFull(); });
+            if (stopping) {
+                return;
+            }
+        }
+
+        // Analizar un lote sin bloquear al consumidor
+        batch.clear();
+        const char* next = cursor;
+        while (cursor < end && batch.size() < BATCH_EVENTS) {
+            const char* eol = lineEnd(cursor, end, next);
+            ParsedEvent event;
+            bool valid = parseEventLine(cursor, eol, event);
+            const char* line = cursor;
+            cursor = next;
+            if (!valid) {
+                int time = 0;
+                int tempo = 0;
+                if (parseTempoLine(line, eol, time, tempo)) {
+                    batch.push_back({time, 0, 0, 0, 0, false, tempo});
+                } else if (eol > line && !isIgnoredEventLine(line, eol)) {
+                    diagnostics.report(ParseIssue::MalformedLine, line - file.begin(), std::string_view(line, eol - line));
+                }
+                continue;
+            }
+
+            if (event.trackIndex < 0 || event.trackIndex >= tracks) {
+                diagnostics.report(ParseIssue::InvalidTrack, line - file.begin(), std::string_view(line, eol - line));
+                continue;
+            }
+            StreamEvent note{event.time, event.trackIndex, event.channel, event.note, event.velocity, event.noteOn, 0};
+            if (!pairNote(note)) {
+                diagnostics.report(ParseIssue::UnmatchedNoteOff, line - file.begin(), std::string_view(line, eol - line));
+                continue;
+            }
+            batch.push_back(note);
+        }
+
+        if (static_cast<std::size_t>(cursor - released) >= RELEASE_BYTES) {
+            file.release(cursor);
+            released = cursor;
+        }
+
+        if (cursor >= end) {
+            diagnostics.printSummary(std::cerr, source);
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        for (const StreamEvent& event : batch) {
+            buffer.push_back(event);
+            if (event.tick > lastTick) {
+                lastTick = event.tick;
+            }
+        }
+        if (cursor >= end) {
+            // Fin del archivo: cerrar en el último tick las notas que no tienen note_off
+            for (std::vector<StreamEvent>& open : openNotes) {
+                for (StreamEvent event : open) {
+                    event.tick = lastTick;
+                    event.noteOn = false;
+                    buffer.push_back(event);
+                }
+                open.clear();
+            }
+        }
+        if (queue != nullptr) {
+            // Con cola: la ventana se vacía en ella, fuera del mutex porque puede esperar
+            outgoing.assign(buffer.begin(), buffer.end());
+            buffer.clear();
+            lock.unlock();
+            if (!pushToQueue(outgoing)) {
+                return;
+            }
+            lock.lock();
+        }
+        if (cursor >= end) {
+            done = true;
+            ready = true;
+            readyCond.notify_all();
+            return;
+        }
+    }
+}
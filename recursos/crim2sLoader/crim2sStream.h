@@ -0,0 +1,100 @@
+// crim2sStream.h
+
+#pragma once
+#include "crim2sLoader.h"
+#include "parseDiagnostics.h"
+#include "spscRing.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Evento note_on/note_off o set_tempo del .crim2s. Cada note_off cierra una nota
+// abierta: los que no tienen note_on no llegan y al final del archivo se añade el
+// note_off de las notas que quedaron sonando.
+struct StreamEvent {
+    int tick;
+    int track;
+    int channel;
+    int note;
+    int velocity;
+    bool noteOn;
+    int microsecondsPerBeat; // Solo en los set_tempo (0 en las notas)
+};
+
+// Cola sin bloqueos del hilo lector al hilo de envío MIDI (ver Crim2sStream::feed)
+using StreamQueue = SpscRing<StreamEvent, 8192>;
+
+// Lectura de un .crim2s en streaming. Un hilo lector analiza el archivo por
+// delante de la reproducción y mantiene solo una ventana de eventos próximos
+// (hasta windowBeats pulsos por delante del último tick consumido, y nunca más de
+// maxBufferedEvents). Las páginas del archivo ya leídas se devuelven al
+// sistema, así que la memoria no crece con la duración de la canción.
+class Crim2sStream {
+public:
+    Crim2sStream() = default;
+    ~Crim2sStream();
+
+    Crim2sStream(const Crim2sStream&) = delete;
+    Crim2sStream& operator=(const Crim2sStream&) = delete;
+
+    // Lee la cabecera y arranca el hilo lector; devuelve false si no se puede abrir
+    bool open(const std::string& filename, float windowBeats, std::size_t maxBufferedEvents = 65536);
+    void close();
+
+    int ticksPerBeat() const { return ticks; }
+    int trackCount() const { return tracks; }
+
+    // Espera a que la primera ventana esté analizada (o a que termine el archivo)
+    void waitReady();
+
+    // Añade a out los eventos con tick <= uptoTick ya leídos y avanza la ventana.
+    // Nunca espera al hilo lector.
+    void poll(int uptoTick, std::vector<StreamEvent>& out);
+
+    // true cuando el archivo se ha leído entero y no quedan eventos pendientes
+    bool finished();
+
+    // A partir de aquí el hilo lector deja los eventos en queue en lugar de en la
+    // ventana de poll(): la cola, de capacidad fija, hace de ventana y el lector espera
+    // cuando está llena. Con cola, finished() significa que todo el archivo está ya en
+    // ella y se puede consultar sin mutex desde el hilo que la vacía. queue debe seguir
+    // viva hasta close().
+    void feed(StreamQueue& queue);
+
+private:
+    void readerLoop();
+
+    // Empareja una nota con las abiertas; false si es un note_off sin note_on
+    bool pairNote(const StreamEvent& event);
+
+    // Pasa los eventos a la cola de feed(); false si se cierra mientras espera hueco
+    bool pushToQueue(const std::vector<StreamEvent>& events);
+
+    MappedFile file;
+    std::string source;
+    ParseDiagnostics diagnostics; // Solo lo usa el hilo lector; el resumen se escribe al terminar
+    std::vector<std::vector<StreamEvent>> openNotes; // note_on sin cerrar por pista (hilo lector)
+    const char* cursor = nullptr;
+    const char* released = nullptr;
+    int ticks = 480;
+    int tracks = 0;
+    int window = 0; // En ticks
+    std::size_t maxBuffered = 0;
+
+    std::thread reader;
+    std::mutex mutex;
+    std::condition_variable canRead;  // El consumidor ha liberado espacio en la ventana
+    std::condition_variable readyCond; // La primera ventana está llena o el archivo terminó
+    std::deque<StreamEvent> buffer;
+    std::atomic<StreamQueue*> queue{nullptr}; // Destino de los eventos tras feed(); finished() lo lee sin mutex
+    int consumerTick = 0;
+    int lastTick = 0;
+    bool ready = false;
+    std::atomic<bool> done{false};
+    bool stopping = false;
+};
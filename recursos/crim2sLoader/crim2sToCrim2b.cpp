@@ -0,0 +1,32 @@
+// crim2sToCrim2b.cpp
+//
+// Convierte un archivo de texto .crim2s al formato binario .crim2b
+
+#include "crim2b.h"
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Uso: " << argv[0] << " <entrada.crim2s> <salida.crim2b>" << std::endl;
+        return -1;
+    }
+
+    int ticksPerBeat = 480;
+    std::vector<TempoEvent> tempoMap;
+    std::vector<Track> tracks = readCrim2sFile(argv[1], ticksPerBeat, NoteOffPairing::FIFO, &tempoMap);
+    if (tracks.empty()) {
+        std::cerr << "Error: no se encontraron pistas en el archivo." << std::endl;
+        return -1;
+    }
+
+    if (!writeCrim2bFile(argv[2], tracks, ticksPerBeat, tempoMap)) {
+        return -1;
+    }
+
+    std::size_t totalNotes = 0;
+    for (const auto& track : tracks) {
+        totalNotes += track.notes.size();
+    }
+    std::cout << "Convertidas " << totalNotes << " notas de " << tracks.size() << " pistas a " << argv[2] << std::endl;
+    return 0;
+}
@@ -0,0 +1,44 @@
+// crim2sToCrim2z.cpp
+//
+// Convierte una canción (.crim2s, .mid o .crim2b) al archivo comprimido .crim2z
+
+#include "crim2b.h"
+#include "crim2z.h"
+#include "smfReader.h"
+#include "songFile.h"
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Uso: " << argv[0] << " <entrada.crim2s|.mid|.crim2b> <salida.crim2z>" << std::endl;
+        return -1;
+    }
+    std::string input = argv[1];
+
+    // Se lee directamente, sin pasar por la caché de canciones
+    int ticksPerBeat = 480;
+    std::vector<TempoEvent> tempoMap;
+    std::vector<Track> tracks;
+    if (hasExtension(input, ".mid") || hasExtension(input, ".midi")) {
+        tracks = readMidiFile(input, ticksPerBeat, NoteOffPairing::FIFO, &tempoMap);
+    } else if (hasExtension(input, ".crim2b")) {
+        tracks = readCrim2bFile(input, ticksPerBeat, &tempoMap);
+    } else {
+        tracks = readCrim2sFileParallel(input, ticksPerBeat, NoteOffPairing::FIFO, 0, &tempoMap);
+    }
+    if (tracks.empty()) {
+        std::cerr << "Error: no se encontraron pistas en el archivo." << std::endl;
+        return -1;
+    }
+
+    if (!writeCrim2zFile(argv[2], tracks, ticksPerBeat, tempoMap)) {
+        return -1;
+    }
+
+    std::size_t totalNotes = 0;
+    for (const auto& track : tracks) {
+        totalNotes += track.notes.size();
+    }
+    std::cout << "Comprimidas " << totalNotes << " notas de " << tracks.size() << " pistas a " << argv[2] << std::endl;
+    return 0;
+}
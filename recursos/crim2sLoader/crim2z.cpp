@@ -0,0 +1,256 @@
+// crim2z.cpp
+
+#include "crim2z.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+std::uint32_t zigzag(std::int64_t value) {
+    return static_cast<std::uint32_t>((static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+}
+
+std::int64_t unzigzag(std::uint32_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+void putVarint(std::vector<unsigned char>& out, std::uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+// Lee un varint de como máximo 5 bytes
+bool getVarint(const unsigned char*& p, const unsigned char* end, std::uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p >= end) {
+            return false;
+        }
+        unsigned char byte = *p++;
+        value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Codifica las notas [first, last) de una pista como un bloque
+void encodeBlock(const std::vector<NoteEvent>& notes, std::size_t first, std::size_t last,
+                 std::vector<unsigned char>& out) {
+    std::int64_t previousStart = notes[first].startTime;
+    int previousChannel = 0;
+    for (std::size_t i = first; i < last; ++i) {
+        const NoteEvent& note = notes[i];
+        putVarint(out, zigzag(note.startTime - previousStart));
+        putVarint(out, zigzag(static_cast<std::int64_t>(note.endTime) - note.startTime));
+        bool channelChanged = note.channel != previousChannel;
+        out.push_back(static_cast<unsigned char>((note.note & 0x7F) | (channelChanged ? 0x80 : 0)));
+        out.push_back(static_cast<unsigned char>(note.velocity));
+        if (channelChanged) {
+            out.push_back(static_cast<unsigned char>(note.channel));
+            previousChannel = note.channel;
+        }
+        previousStart = note.startTime;
+    }
+}
+
+} // namespace
+
+bool Crim2zArchive::open(const std::string& filename) {
+    header = nullptr;
+    trackEntries = nullptr;
+    blocks = nullptr;
+    tempo.clear();
+    if (!file.open(filename)) {
+        return false;
+    }
+
+    const char* base = file.begin();
+    std::uint64_t size = file.size();
+    if (size < sizeof(Crim2zHeader)) {
+        return false;
+    }
+    const Crim2zHeader* h = reinterpret_cast<const Crim2zHeader*>(base);
+    if (std::memcmp(h->magic, CRIM2Z_MAGIC, 4) != 0 || h->version != CRIM2Z_VERSION) {
+        return false;
+    }
+
+    std::uint64_t tempoOffset = sizeof(Crim2zHeader);
+    std::uint64_t tracksOffset = tempoOffset + std::uint64_t(h->tempoCount) * sizeof(TempoEvent);
+    std::uint64_t blocksOffset = tracksOffset + std::uint64_t(h->trackCount) * sizeof(Crim2zTrackEntry);
+    std::uint64_t indexEnd = blocksOffset + std::uint64_t(h->blockCount) * sizeof(Crim2zBlockEntry);
+    if (indexEnd > size) {
+        return false;
+    }
+
+    // Validar el índice una vez para que decodeBlock no tenga que comprobar rangos del archivo
+    const Crim2zTrackEntry* t = reinterpret_cast<const Crim2zTrackEntry*>(base + tracksOffset);
+    const Crim2zBlockEntry* b = reinterpret_cast<const Crim2zBlockEntry*>(base + blocksOffset);
+    for (std::uint32_t i = 0; i < h->trackCount; ++i) {
+        if (std::uint64_t(t[i].firstBlock) + t[i].blockCount > h->blockCount) {
+            return false;
+        }
+    }
+    for (std::uint32_t i = 0; i < h->blockCount; ++i) {
+        if (b[i].offset < indexEnd || b[i].offset > size || b[i].byteLength > size - b[i].offset) {
+            return false;
+        }
+    }
+
+    tempo.resize(h->tempoCount);
+    if (h->tempoCount > 0) {
+        std::memcpy(tempo.data(), base + tempoOffset, h->tempoCount * sizeof(TempoEvent));
+    }
+    header = h;
+    trackEntries = t;
+    blocks = b;
+    return true;
+}
+
+std::size_t Crim2zArchive::findBlock(std::size_t track, int tick) const {
+    const Crim2zBlockEntry* first = blocks + trackEntries[track].firstBlock;
+    const Crim2zBlockEntry* last = first + trackEntries[track].blockCount;
+    // Primer bloque cuya última nota empieza en tick o después
+    const Crim2zBlockEntry* it = std::lower_bound(first, last, tick,
+        [](const Crim2zBlockEntry& entry, int value) { return entry.lastTick < value; });
+    return static_cast<std::size_t>(it - first);
+}
+
+bool Crim2zArchive::decodeBlock(std::size_t track, std::size_t index, std::vector<NoteEvent>& out) const {
+    const Crim2zBlockEntry& entry = block(track, index);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(file.begin() + entry.offset);
+    const unsigned char* end = p + entry.byteLength;
+
+    std::int64_t start = entry.firstTick;
+    int channel = 0;
+    out.reserve(out.size() + entry.noteCount);
+    for (std::uint32_t i = 0; i < entry.noteCount; ++i) {
+        std::uint32_t delta = 0;
+        std::uint32_t duration = 0;
+        if (!getVarint(p, end, delta) || !getVarint(p, end, duration) || end - p < 2) {
+            return false;
+        }
+        unsigned char pitch = *p++;
+        unsigned char velocity = *p++;
+        if (pitch & 0x80) {
+            if (p >= end) {
+                return false;
+            }
+            channel = *p++;
+        }
+        start += unzigzag(delta);
+
+        NoteEvent note;
+        note.note = pitch & 0x7F;
+        note.startTime = static_cast<int>(start);
+        note.endTime = static_cast<int>(start + unzigzag(duration));
+        note.channel = channel;
+        note.velocity = velocity;
+        out.push_back(note);
+    }
+    return true;
+}
+
+bool Crim2zArchive::decodeTrack(std::size_t track, Track& out) const {
+    out.notes.clear();
+    out.notes.reserve(noteCount(track));
+    for (std::size_t i = 0; i < blockCount(track); ++i) {
+        if (!decodeBlock(track, i, out.notes)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<Track> Crim2zArchive::toTracks() const {
+    std::vector<Track> result(trackCount());
+    for (std::size_t i = 0; i < result.size(); ++i) {
+        if (!decodeTrack(i, result[i])) {
+            std::cerr << "Advertencia: bloque dañado en la pista " << i << std::endl;
+        }
+    }
+    return result;
+}
+
+// Escribe las pistas (ya emparejadas) en formato .crim2z
+bool writeCrim2zFile(const std::string& filename, const std::vector<Track>& tracks, int ticksPerBeat,
+                     const std::vector<TempoEvent>& tempoMap, std::uint32_t notesPerBlock) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error al crear el archivo " << filename << std::endl;
+        return false;
+    }
+    notesPerBlock = std::max<std::uint32_t>(1, notesPerBlock);
+
+    // Comprimir todos los bloques antes de escribir para conocer el índice
+    std::vector<Crim2zTrackEntry> trackEntries(tracks.size());
+    std::vector<Crim2zBlockEntry> blockEntries;
+    std::vector<unsigned char> data;
+    for (std::size_t t = 0; t < tracks.size(); ++t) {
+        const std::vector<NoteEvent>& notes = tracks[t].notes;
+        trackEntries[t].firstBlock = static_cast<std::uint32_t>(blockEntries.size());
+        trackEntries[t].noteCount = static_cast<std::uint32_t>(notes.size());
+        trackEntries[t].reserved = 0;
+        for (std::size_t first = 0; first < notes.size(); first += notesPerBlock) {
+            std::size_t last = std::min<std::size_t>(first + notesPerBlock, notes.size());
+            Crim2zBlockEntry entry;
+            entry.offset = data.size(); // Relativo a los datos; se corrige más abajo
+            entry.noteCount = static_cast<std::uint32_t>(last - first);
+            entry.firstTick = notes[first].startTime;
+            entry.lastTick = notes[last - 1].startTime;
+            encodeBlock(notes, first, last, data);
+            entry.byteLength = static_cast<std::uint32_t>(data.size() - entry.offset);
+            blockEntries.push_back(entry);
+        }
+        trackEntries[t].blockCount = static_cast<std::uint32_t>(blockEntries.size()) - trackEntries[t].firstBlock;
+    }
+
+    Crim2zHeader header;
+    std::memcpy(header.magic, CRIM2Z_MAGIC, 4);
+    header.version = CRIM2Z_VERSION;
+    header.ticksPerBeat = ticksPerBeat;
+    header.trackCount = static_cast<std::uint32_t>(tracks.size());
+    header.tempoCount = static_cast<std::uint32_t>(tempoMap.size());
+    header.blockCount = static_cast<std::uint32_t>(blockEntries.size());
+
+    std::uint64_t dataOffset = sizeof(Crim2zHeader) + tempoMap.size() * sizeof(TempoEvent)
+                             + trackEntries.size() * sizeof(Crim2zTrackEntry)
+                             + blockEntries.size() * sizeof(Crim2zBlockEntry);
+    for (auto& entry : blockEntries) {
+        entry.offset += dataOffset;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!tempoMap.empty()) {
+        out.write(reinterpret_cast<const char*>(tempoMap.data()), tempoMap.size() * sizeof(TempoEvent));
+    }
+    if (!trackEntries.empty()) {
+        out.write(reinterpret_cast<const char*>(trackEntries.data()), trackEntries.size() * sizeof(Crim2zTrackEntry));
+    }
+    if (!blockEntries.empty()) {
+        out.write(reinterpret_cast<const char*>(blockEntries.data()), blockEntries.size() * sizeof(Crim2zBlockEntry));
+    }
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(out);
+}
+
+// Lee un .crim2z y devuelve las pistas, igual que readCrim2sFile
+std::vector<Track> readCrim2zFile(const std::string& filename, int& ticksPerBeat,
+                                  std::vector<TempoEvent>* tempoMap) {
+    Crim2zArchive archive;
+    if (!archive.open(filename)) {
+        std::cerr << "Error al abrir el archivo " << filename << " (no es un .crim2z válido)" << std::endl;
+        return {};
+    }
+    ticksPerBeat = archive.ticksPerBeat();
+    if (tempoMap) {
+        *tempoMap = archive.tempoMap();
+    }
+    return archive.toTracks();
+}
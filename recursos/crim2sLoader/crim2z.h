@@ -0,0 +1,94 @@
+// crim2z.h
+
+#pragma once
+#include "crim2sLoader.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Archivo comprimido .crim2z (little-endian) para guardar muchas canciones:
+//
+//   Crim2zHeader
+//   TempoEvent            tempo[tempoCount]
+//   Crim2zTrackEntry      tracks[trackCount]
+//   Crim2zBlockEntry      blocks[blockCount]   (índice; los de cada pista son contiguos)
+//   datos de los bloques
+//
+// Cada bloque guarda hasta notesPerBlock notas de una pista, ya emparejadas:
+//   varint  zigzag(inicio - inicio de la nota anterior)   (la primera, respecto a firstTick)
+//   varint  zigzag(fin - inicio)
+//   uint8   nota | 0x80 si el canal cambia respecto a la nota anterior
+//   uint8   velocidad
+//   [uint8  canal]                                         (solo si cambia)
+// El índice permite ir a cualquier pista o bloque de tiempo sin descomprimir el resto.
+
+const char CRIM2Z_MAGIC[4] = {'C', 'R', '2', 'Z'};
+const std::uint32_t CRIM2Z_VERSION = 1;
+const std::uint32_t CRIM2Z_NOTES_PER_BLOCK = 1024;
+
+struct Crim2zHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::int32_t ticksPerBeat;
+    std::uint32_t trackCount;
+    std::uint32_t tempoCount;
+    std::uint32_t blockCount;
+};
+
+struct Crim2zTrackEntry {
+    std::uint32_t firstBlock;
+    std::uint32_t blockCount;
+    std::uint32_t noteCount;
+    std::uint32_t reserved;
+};
+
+struct Crim2zBlockEntry {
+    std::uint64_t offset;     // Desde el inicio del archivo
+    std::uint32_t byteLength;
+    std::uint32_t noteCount;
+    std::int32_t firstTick;   // Inicio de la primera nota del bloque
+    std::int32_t lastTick;    // Inicio de la última nota del bloque
+};
+
+// Archivo .crim2z proyectado en memoria; los bloques se descomprimen bajo demanda
+class Crim2zArchive {
+public:
+    // Proyecta y valida el archivo y su índice; devuelve false si no es un .crim2z válido
+    bool open(const std::string& filename);
+
+    int ticksPerBeat() const { return header ? header->ticksPerBeat : 480; }
+    std::size_t trackCount() const { return header ? header->trackCount : 0; }
+    const std::vector<TempoEvent>& tempoMap() const { return tempo; }
+
+    std::size_t noteCount(std::size_t track) const { return trackEntries[track].noteCount; }
+    std::size_t blockCount(std::size_t track) const { return trackEntries[track].blockCount; }
+    const Crim2zBlockEntry& block(std::size_t track, std::size_t index) const {
+        return blocks[trackEntries[track].firstBlock + index];
+    }
+
+    // Bloque de la pista donde empiezan las notas con inicio >= tick (búsqueda binaria en el índice)
+    std::size_t findBlock(std::size_t track, int tick) const;
+
+    // Descomprime un bloque y añade sus notas a out; devuelve false si está dañado
+    bool decodeBlock(std::size_t track, std::size_t index, std::vector<NoteEvent>& out) const;
+
+    // Descomprime una pista completa o todas
+    bool decodeTrack(std::size_t track, Track& out) const;
+    std::vector<Track> toTracks() const;
+
+private:
+    MappedFile file;
+    const Crim2zHeader* header = nullptr;
+    const Crim2zTrackEntry* trackEntries = nullptr;
+    const Crim2zBlockEntry* blocks = nullptr;
+    std::vector<TempoEvent> tempo;
+};
+
+// Escribe las pistas (ya emparejadas) en formato .crim2z
+bool writeCrim2zFile(const std::string& filename, const std::vector<Track>& tracks, int ticksPerBeat,
+                     const std::vector<TempoEvent>& tempoMap,
+                     std::uint32_t notesPerBlock = CRIM2Z_NOTES_PER_BLOCK);
+
+// Lee un .crim2z y devuelve las pistas, igual que readCrim2sFile
+std::vector<Track> readCrim2zFile(const std::string& filename, int& ticksPerBeat,
+                                  std::vector<TempoEvent>* tempoMap = nullptr);
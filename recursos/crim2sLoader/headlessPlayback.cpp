@@ -0,0 +1,86 @@
+// headlessPlayback.cpp
+
+#include "headlessPlayback.h"
+#include "midiDispatcher.h"
+#include "noteScheduler.h"
+#include "playbackClock.h"
+#include "songFile.h"
+#include <algorithm>
+#include <iostream>
+
+HeadlessStats runHeadless(const std::vector<Track>& tracks, const TempoMap& tempoMap, MidiSink& sink) {
+    HeadlessStats stats;
+    std::vector<NoteScheduler> schedulers(tracks.begin(), tracks.end());
+
+    // El mismo envío que los visores, paso a paso: el reloj simulado salta a lo
+    // siguiente que toca en cuanto se ha enviado lo anterior
+    PlaybackClock clock;
+    MidiDispatcher dispatcher(Timeline(tracks), tempoMap, clock, sink);
+    std::vector<TimelineEvent> sent;
+
+    std::vector<std::int64_t> tickNanos;
+    int polyphony = 0;
+    int visualNotes = 0;
+
+    std::int64_t start = PlaybackClock::steadyNanos();
+    std::int64_t songNanos = 0;
+    while (songNanos >= 0) {
+        std::int64_t before = PlaybackClock::steadyNanos();
+
+        std::int64_t next = dispatcher.dispatchUntil(songNanos);
+        sent.clear();
+        dispatcher.drain(sent);
+        for (const TimelineEvent& event : sent) {
+            polyphony += event.noteOn ? 1 : -1;
+            stats.peakPolyphony = std::max(stats.peakPolyphony, polyphony);
+        }
+        stats.events += sent.size();
+
+        int tick = static_cast<int>(tempoMap.microsToTick(songNanos / 1000));
+        for (NoteScheduler& scheduler : schedulers) {
+            scheduler.advance(tick, [&](const NoteEvent&) { ++visualNotes; }, [&](const NoteEvent&) { --visualNotes; });
+        }
+
+        tickNanos.push_back(PlaybackClock::steadyNanos() - before);
+        stats.songMicros = songNanos / 1000;
+        songNanos = next;
+    }
+    stats.totalNanos = PlaybackClock::steadyNanos() - start;
+    stats.ticks = tickNanos.size();
+
+    if (!tickNanos.empty()) {
+        std::sort(tickNanos.begin(), tickNanos.end());
+        stats.medianTickNanos = tickNanos[tickNanos.size() / 2];
+        stats.p99TickNanos = tickNanos[tickNanos.size() * 99 / 100];
+        stats.maxTickNanos = tickNanos.back();
+    }
+    return stats;
+}
+
+void printHeadlessStats(std::ostream& out, const HeadlessStats& stats, const std::string& source) {
+    double seconds = stats.totalNanos / 1e9;
+    out << source << ":\n"
+        << "  eventos: " << stats.events << " en " << stats.ticks << " ticks, polifonía máxima " << stats.peakPolyphony << "\n"
+        << "  canción: " << stats.songMicros / 1e6 << " s, recorrida en " << seconds * 1000 << " ms";
+    if (stats.totalNanos > 0) {
+        out << " (" << static_cast<std::uint64_t>(stats.events / seconds) << " eventos/s, x"
+            << static_cast<std::uint64_t>(stats.songMicros * 1000.0 / stats.totalNanos) << " tiempo real)";
+    }
+    out << "\n"
+        << "  coste por tick: mediana " << stats.medianTickNanos << " ns, p99 " << stats.p99TickNanos
+        << " ns, máximo " << stats.maxTickNanos << " ns" << std::endl;
+}
+
+int runHeadlessFile(const std::string& filename, float bpm) {
+    int ticksPerBeat = 480;
+    std::vector<TempoEvent> tempoEvents;
+    std::vector<Track> tracks = loadSongFile(filename, ticksPerBeat, &tempoEvents);
+    if (tracks.empty()) {
+        std::cerr << "Error: no se encontraron pistas en el archivo " << filename << std::endl;
+        return -1;
+    }
+    TempoMap tempoMap(ticksPerBeat, tempoEvents, bpmToMicrosecondsPerBeat(bpm));
+    NullMidiSink sink;
+    printHeadlessStats(std::cout, runHeadless(tracks, tempoMap, sink), filename);
+    return 0;
+}
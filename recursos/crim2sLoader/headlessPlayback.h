@@ -0,0 +1,35 @@
+// headlessPlayback.h
+
+#pragma once
+#include "crim2sLoader.h"
+#include "midiSink.h"
+#include "tempoMap.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Resultado de una reproducción sin ventana
+struct HeadlessStats {
+    std::uint64_t events = 0;       // note_on + note_off enviados
+    std::uint64_t ticks = 0;        // Pasos del reloj simulado (ticks con eventos)
+    int peakPolyphony = 0;          // Máximo de notas sonando a la vez
+    std::int64_t songMicros = 0;    // Duración de la canción según el mapa de tempo
+    std::int64_t totalNanos = 0;    // Tiempo real de todo el recorrido
+    std::int64_t medianTickNanos = 0;
+    std::int64_t p99TickNanos = 0;
+    std::int64_t maxTickNanos = 0;
+};
+
+// Reproduce la canción con un reloj simulado que salta de un tick con eventos al
+// siguiente, lo más rápido posible. En cada tick hace lo mismo que los visores:
+// un paso del MidiDispatcher (MidiDispatcher::dispatchUntil, con sus ráfagas a
+// sink), la lectura de lo enviado y los planificadores de notas por pista del
+// dibujo, y mide cuánto cuesta.
+HeadlessStats runHeadless(const std::vector<Track>& tracks, const TempoMap& tempoMap, MidiSink& sink);
+
+void printHeadlessStats(std::ostream& out, const HeadlessStats& stats, const std::string& source);
+
+// Carga el archivo, lo reproduce sin ventana contra un NullMidiSink y escribe las
+// estadísticas en std::cout. Devuelve 0 o -1 si no se pudo cargar.
+int runHeadlessFile(const std::string& filename, float bpm);
@@ -0,0 +1,93 @@
+// intervalIndex.cpp
+
+#include "intervalIndex.h"
+#include <algorithm>
+
+void IntervalIndex::build(const std::vector<Interval>& intervals) {
+    bounds = intervals;
+    nodes.clear();
+    byStart.clear();
+    byEnd.clear();
+
+    std::vector<std::uint32_t> items;
+    items.reserve(intervals.size());
+    for (std::size_t i = 0; i < intervals.size(); ++i) {
+        if (intervals[i].end > intervals[i].start) {
+            items.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+    byStart.reserve(items.size());
+    byEnd.reserve(items.size());
+    root = buildNode(items);
+}
+
+std::int32_t IntervalIndex::buildNode(std::vector<std::uint32_t>& items) {
+    if (items.empty()) {
+        return -1;
+    }
+
+    // Centro: la mediana de los inicios. El intervalo de la mediana contiene el centro,
+    // así que el nodo nunca queda vacío y cada hijo recibe como mucho la mitad.
+    std::vector<std::uint32_t> order(items);
+    std::size_t middle = order.size() / 2;
+    std::nth_element(order.begin(), order.begin() + middle, order.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return bounds[a].start < bounds[b].start; });
+    int center = bounds[order[middle]].start;
+
+    std::vector<std::uint32_t> left;
+    std::vector<std::uint32_t> right;
+    std::vector<std::uint32_t> here;
+    for (std::uint32_t i : items) {
+        if (bounds[i].end <= center) {
+            left.push_back(i);
+        } else if (bounds[i].start > center) {
+            right.push_back(i);
+        } else {
+            here.push_back(i);
+        }
+    }
+    std::vector<std::uint32_t>().swap(items);
+
+    Node node;
+    node.center = center;
+    node.first = static_cast<std::uint32_t>(byStart.size());
+    node.count = static_cast<std::uint32_t>(here.size());
+    std::stable_sort(here.begin(), here.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return bounds[a].start < bounds[b].start; });
+    byStart.insert(byStart.end(), here.begin(), here.end());
+    std::stable_sort(here.begin(), here.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return bounds[a].end > bounds[b].end; });
+    byEnd.insert(byEnd.end(), here.begin(), here.end());
+
+    std::int32_t index = static_cast<std::int32_t>(nodes.size());
+    nodes.push_back(node);
+    std::int32_t leftChild = buildNode(left);
+    std::int32_t rightChild = buildNode(right);
+    nodes[index].left = leftChild;
+    nodes[index].right = rightChild;
+    return index;
+}
+
+void IntervalIndex::stab(std::int64_t t, std::vector<std::size_t>& out) const {
+    std::size_t firstFound = out.size();
+    std::int32_t current = root;
+    while (current >= 0) {
+        const Node& node = nodes[current];
+        const std::uint32_t* begin = byStart.data() + node.first;
+        if (t < node.center) {
+            // Todos terminan después del centro: basta con que empiecen en t o antes
+            for (std::uint32_t i = 0; i < node.count && bounds[begin[i]].start <= t; ++i) {
+                out.push_back(begin[i]);
+            }
+            current = node.left;
+        } else {
+            // Todos empiezan en el centro o antes: basta con que terminen después de t
+            const std::uint32_t* ends = byEnd.data() + node.first;
+            for (std::uint32_t i = 0; i < node.count && bounds[ends[i]].end > t; ++i) {
+                out.push_back(ends[i]);
+            }
+            current = node.right;
+        }
+    }
+    std::sort(out.begin() + firstFound, out.end());
+}
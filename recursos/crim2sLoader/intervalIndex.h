@@ -0,0 +1,45 @@
+// intervalIndex.h
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Intervalo semiabierto [start, end) en ticks
+struct Interval {
+    int start;
+    int end;
+};
+
+// Árbol de intervalos centrado, estático y en arreglos planos. Responde "qué
+// intervalos contienen t" en O(log n + k). Cada nodo guarda los intervalos que
+// contienen su centro ordenados por inicio y por final; los de la izquierda
+// terminan antes del centro y los de la derecha empiezan después.
+class IntervalIndex {
+public:
+    IntervalIndex() = default;
+    explicit IntervalIndex(const std::vector<Interval>& intervals) { build(intervals); }
+
+    // Los intervalos vacíos (end <= start) no contienen ningún instante y se omiten
+    void build(const std::vector<Interval>& intervals);
+
+    // Añade a out los índices de los intervalos con start <= t < end, ordenados por índice
+    void stab(std::int64_t t, std::vector<std::size_t>& out) const;
+
+private:
+    struct Node {
+        int center;
+        std::uint32_t first;  // Posición en byStart/byEnd
+        std::uint32_t count;
+        std::int32_t left;    // -1 si no hay hijo
+        std::int32_t right;
+    };
+
+    std::int32_t buildNode(std::vector<std::uint32_t>& items);
+
+    std::vector<Interval> bounds;         // Copia de los intervalos (el índice no depende del original)
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> byStart;   // Por nodo, ascendente por inicio
+    std::vector<std::uint32_t> byEnd;     // Por nodo, descendente por final
+    std::int32_t root = -1;
+};
@@ -0,0 +1,29 @@
+// koloreoBench.cpp
+// Mide el planificador sin ventana ni MIDI sobre uno o varios archivos:
+//   ./koloreoBench [--bpm N] ../../midifiles/*.mid
+
+#include "headlessPlayback.h"
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    float bpm = 120.0f;
+    int first = 1;
+    if (argc >= 3 && std::string(argv[1]) == "--bpm") {
+        bpm = std::stof(argv[2]);
+        first = 3;
+    }
+    if (first >= argc) {
+        std::cerr << "Uso: " << argv[0] << " [--bpm N] <archivo .mid, .crim2s, .crim2b o .crim2z>..." << std::endl;
+        std::cerr << "bpm: tempo inicial, hasta el primer cambio de tempo del archivo (120 por defecto)" << std::endl;
+        return -1;
+    }
+
+    int result = 0;
+    for (int i = first; i < argc; ++i) {
+        if (runHeadlessFile(argv[i], bpm) != 0) {
+            result = -1;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,61 @@
+// loopRegion.cpp
+
+#include "loopRegion.h"
+#include <iostream>
+
+LoopRegion::LoopRegion(const TempoMap& tempoMap, int startTick, int endTick)
+    : start(startTick), end(endTick),
+      startMicros(tempoMap.tickToMicros(startTick)), endMicros(tempoMap.tickToMicros(endTick)) {}
+
+std::int64_t LoopRegion::wrap(std::int64_t clockMicros, std::int64_t& lap) const {
+    if (!active() || clockMicros < endMicros) {
+        lap = 0;
+        return clockMicros;
+    }
+    std::int64_t length = lengthMicros();
+    lap = (clockMicros - startMicros) / length;
+    return startMicros + (clockMicros - startMicros) % length;
+}
+
+namespace {
+
+// Lee un número entero con sufijo opcional "t"; ticks indica si lo llevaba
+bool parseLoopPoint(const std::string& text, long& value, bool& ticks) {
+    ticks = !text.empty() && text.back() == 't';
+    std::string digits = ticks ? text.substr(0, text.size() - 1) : text;
+    if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    value = std::stol(digits);
+    return true;
+}
+
+} // namespace
+
+bool parseLoopRegion(const std::string& text, const TempoMap& tempoMap, LoopRegion& loop) {
+    std::size_t colon = text.find(':');
+    long first = 0;
+    long last = 0;
+    bool firstTicks = false;
+    bool lastTicks = false;
+    if (colon == std::string::npos || !parseLoopPoint(text.substr(0, colon), first, firstTicks) ||
+        !parseLoopPoint(text.substr(colon + 1), last, lastTicks) || firstTicks != lastTicks) {
+        std::cerr << "Error: bucle no válido '" << text << "' (usa compases A:B o ticks At:Bt)" << std::endl;
+        return false;
+    }
+
+    long startTick = first;
+    long endTick = last;
+    if (!firstTicks) {
+        // Compases de 4 pulsos: el archivo no guarda el compás
+        long ticksPerBar = 4L * tempoMap.ticksPerBeat();
+        startTick = (first - 1) * ticksPerBar;
+        endTick = last * ticksPerBar;
+    }
+    if (startTick < 0 || endTick <= startTick || endTick > 0x7FFFFFFF) {
+        std::cerr << "Error: el bucle '" << text << "' está vacío o empieza antes del compás 1" << std::endl;
+        return false;
+    }
+    loop = LoopRegion(tempoMap, static_cast<int>(startTick), static_cast<int>(endTick));
+    return true;
+}
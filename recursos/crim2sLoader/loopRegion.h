@@ -0,0 +1,35 @@
+// loopRegion.h
+
+#pragma once
+#include "tempoMap.h"
+#include <cstdint>
+#include <string>
+
+// Región A/B que se repite sin fin: ticks [startTick, endTick). El reloj de
+// reproducción sigue siendo lineal; wrap() convierte su posición en la posición
+// dentro de la canción y cuenta las vueltas, igual para el envío MIDI y el dibujo.
+class LoopRegion {
+public:
+    LoopRegion() = default; // Sin bucle
+    LoopRegion(const TempoMap& tempoMap, int startTick, int endTick);
+
+    bool active() const { return endMicros > startMicros; }
+    int startTick() const { return start; }
+    int endTick() const { return end; }
+    std::int64_t endMicrosInSong() const { return endMicros; }
+    std::int64_t lengthMicros() const { return endMicros - startMicros; }
+
+    // Posición en la canción para una posición del reloj; lap recibe las vueltas
+    // completadas (0 antes de llegar al final del bucle por primera vez)
+    std::int64_t wrap(std::int64_t clockMicros, std::int64_t& lap) const;
+
+private:
+    int start = 0;
+    int end = 0;
+    std::int64_t startMicros = 0;
+    std::int64_t endMicros = 0;
+};
+
+// Interpreta "A:B" en compases (del inicio del compás A al final del B, contando
+// desde 1 y en 4/4) o "At:Bt" en ticks ([A, B)). Escribe el error en std::cerr.
+bool parseLoopRegion(const std::string& text, const TempoMap& tempoMap, LoopRegion& loop);
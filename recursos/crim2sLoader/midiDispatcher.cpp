@@ -0,0 +1,348 @@
+// midiDispatcher.cpp
+
+#include "midiDispatcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+namespace {
+
+// Tramo máximo de sueño, para que stop(), las pausas y los cambios de velocidad
+// se noten aunque el siguiente evento esté lejos
+const std::int64_t MAX_SLEEP_NANOS = 2000000;
+
+// steady_clock es CLOCK_MONOTONIC en Linux: se duerme en el mismo reloj que el de reproducción
+void sleepUntil(std::int64_t nanos) {
+    timespec deadline;
+    deadline.tv_sec = nanos / 1000000000;
+    deadline.tv_nsec = nanos % 1000000000;
+    // Reintentar si una señal interrumpe el sueño
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+    }
+}
+
+} // namespace
+
+MidiDispatcher::MidiDispatcher(Timeline timeline, TempoMap tempoMap, PlaybackClock& clock, MidiSink& sink,
+                               std::int64_t offsetMicros)
+    : timeline(std::move(timeline)), tempoMap(std::move(tempoMap)), clock(clock), sink(sink),
+      offset(offsetMicros) {}
+
+MidiDispatcher::~MidiDispatcher() {
+    stop();
+    if (stream != nullptr) {
+        stream->close(); // El lector no puede seguir escribiendo en una cola que ya no existe
+    }
+}
+
+void MidiDispatcher::start() {
+    stop();
+    timeline.rewind();
+    firedTick = -1;
+    firedLap = 0;
+    launch();
+}
+
+void MidiDispatcher::setLoop(const LoopRegion& region) {
+    loop = region;
+    loopExit.clear();
+    loopEntry.clear();
+    if (!loop.active()) {
+        return;
+    }
+    int lastTick = loop.endTick() - 1;
+    timeline.soundingAt(lastTick, loopExit);
+    for (TimelineEvent& event : loopExit) {
+        event.tick = lastTick;
+        event.noteOn = false;
+    }
+    timeline.soundingAt(loop.startTick(), loopEntry);
+    for (TimelineEvent& event : loopEntry) {
+        event.tick = loop.startTick();
+    }
+    loopEntryPosition = timeline.positionAfter(loop.startTick());
+}
+
+void MidiDispatcher::setTrackFilter(const TrackFilter& trackFilter) {
+    filter = &trackFilter;
+    filterVersion = filter->version();
+    mask = filter->mask();
+}
+
+void MidiDispatcher::setStream(Crim2sStream& source) {
+    stream = &source;
+    streamQueue.reset(new StreamQueue());
+    stream->feed(*streamQueue);
+}
+
+void MidiDispatcher::soundingNow(std::vector<TimelineEvent>& out) const {
+    if (stream != nullptr) {
+        out.insert(out.end(), streamSounding.begin(), streamSounding.end());
+    } else {
+        timeline.soundingAt(firedTick, out);
+    }
+}
+
+bool MidiDispatcher::nextStreamEvent() {
+    while (!hasStreamNext && !streamEnded) {
+        // finished() antes que pop(): si ya había terminado, lo que queda está en la cola
+        bool finished = stream->finished();
+        if (!streamQueue->pop(streamNext)) {
+            streamEnded = finished;
+            return false;
+        }
+        // Un set_tempo solo cambia lo que va después de su tick: se aplica al llegar
+        if (streamNext.microsecondsPerBeat > 0) {
+            tempoMap.append(streamNext.tick, streamNext.microsecondsPerBeat);
+            continue;
+        }
+        hasStreamNext = true;
+    }
+    return hasStreamNext;
+}
+
+bool MidiDispatcher::advanceStream(std::int64_t songMicros, bool send) {
+    while (nextStreamEvent()) {
+        if (tempoMap.tickToMicros(streamNext.tick) > songMicros) {
+            return true;
+        }
+        hasStreamNext = false;
+        TimelineEvent event{streamNext.tick, streamNext.track, static_cast<std::uint8_t>(streamNext.channel),
+                            static_cast<std::uint8_t>(streamNext.note), static_cast<std::uint8_t>(streamNext.velocity),
+                            streamNext.noteOn};
+        if (event.noteOn) {
+            streamSounding.push_back(event);
+        } else {
+            // El lector ya emparejó las notas: el note_off cierra la más antigua
+            auto it = std::find_if(streamSounding.begin(), streamSounding.end(), [&](const TimelineEvent& on) {
+                return on.track == event.track && on.channel == event.channel && on.note == event.note;
+            });
+            if (it != streamSounding.end()) {
+                streamSounding.erase(it);
+            }
+        }
+        if (send) {
+            emit(event);
+        }
+    }
+    // Cola vacía: true si es el final del archivo, false si el lector aún no ha llegado
+    return streamEnded;
+}
+
+void MidiDispatcher::applyTrackFilter() {
+    TrackMask previous = mask;
+    filterVersion = filter->version();
+    mask = filter->mask();
+
+    // Solo cambian las notas que suenan ahora y cuya pista o canal ha cambiado
+    std::vector<TimelineEvent> sounding;
+    soundingNow(sounding);
+    for (TimelineEvent event : sounding) {
+        bool was = previous.audible(event.track, event.channel);
+        bool now = mask.audible(event.track, event.channel);
+        if (was != now) {
+            event.tick = static_cast<int>(firedTick);
+            event.noteOn = now;
+            append(event);
+        }
+    }
+    flush();
+}
+
+void MidiDispatcher::wrapLoop() {
+    // Terminar la vuelta (si el hilo llegó tarde) y soltar lo que cruza el final
+    timeline.advance(loop.endTick() - 1, [&](const TimelineEvent& event) { emit(event); });
+    for (const TimelineEvent& event : loopExit) {
+        emit(event);
+    }
+    flush();
+
+    // Empezar otra desde el inicio con lo que ya sonaba en él
+    timeline.setPosition(loopEntryPosition);
+    for (const TimelineEvent& event : loopEntry) {
+        emit(event);
+    }
+    flush();
+    firedTick = loop.startTick();
+}
+
+void MidiDispatcher::launch() {
+    stopping = false;
+    done = false;
+    dispatcher = std::thread(&MidiDispatcher::dispatchLoop, this);
+}
+
+void MidiDispatcher::seek(std::int64_t songNanos) {
+    if (stream != nullptr && songNanos <= clock.nanos()) {
+        return;
+    }
+    bool wasRunning = dispatcher.joinable();
+    stop();
+
+    // Apagar lo que sonaba en la posición anterior (una sola ráfaga, en ese tick)
+    std::vector<TimelineEvent> sounding;
+    soundingNow(sounding);
+    for (TimelineEvent event : sounding) {
+        event.tick = static_cast<int>(firedTick);
+        event.noteOn = false;
+        emit(event);
+    }
+    flush();
+
+    // Mover el reloj con el hilo parado
+    clock.seek(songNanos);
+
+    // Encender lo que suena en la nueva, sin repetir los eventos anteriores
+    std::int64_t songMicros = loop.wrap(clock.micros() - offset, firedLap);
+    if (stream != nullptr) {
+        // Leer sin enviar hasta la nueva posición, esperando al lector si aún no ha llegado
+        while (!advanceStream(songMicros, false)) {
+            std::this_thread::yield();
+        }
+    }
+    firedTick = songMicros < 0 ? -1 : tempoMap.microsToTick(songMicros);
+    timeline.seek(firedTick);
+    sounding.clear();
+    soundingNow(sounding);
+    for (TimelineEvent event : sounding) {
+        event.tick = static_cast<int>(firedTick);
+        emit(event);
+    }
+    flush();
+
+    if (wasRunning) {
+        launch();
+    }
+}
+
+void MidiDispatcher::emit(const TimelineEvent& event) {
+    if (mask.audible(event.track, event.channel)) {
+        append(event);
+    }
+}
+
+void MidiDispatcher::append(const TimelineEvent& event) {
+    // Un tick nuevo (o la ráfaga llena) cierra la ráfaga anterior
+    if (burstSize > 0 && (event.tick != burstTick || burstSize == BURST_CAPACITY)) {
+        flush();
+    }
+    burstTick = event.tick;
+    burst[burstSize] = noteMessage(event);
+    burstEvents[burstSize] = event;
+    ++burstSize;
+}
+
+void MidiDispatcher::flush() {
+    if (burstSize == 0) {
+        return;
+    }
+    std::int64_t before = PlaybackClock::steadyNanos();
+    sink.send(burst, burstSize);
+    nanosSending.fetch_add(PlaybackClock::steadyNanos() - before, std::memory_order_relaxed);
+    messagesSent.fetch_add(burstSize, std::memory_order_relaxed);
+
+    // El dibujo solo ve lo que ya ha salido
+    for (std::size_t i = 0; i < burstSize; ++i) {
+        if (!sent.push(burstEvents[i])) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    burstSize = 0;
+}
+
+void MidiDispatcher::printSendStats(std::ostream& out) const {
+    std::uint64_t messages = messagesSent;
+    out << "Envío MIDI: " << messages << " mensajes";
+    if (messages > 0) {
+        out << ", " << nanosSending / messages << " ns por mensaje";
+    }
+    if (dropped > 0) {
+        out << ", " << dropped << " eventos no llegaron al dibujo";
+    }
+    out << std::endl;
+}
+
+void MidiDispatcher::stop() {
+    if (dispatcher.joinable()) {
+        stopping = true;
+        dispatcher.join();
+    }
+}
+
+void MidiDispatcher::drain(std::vector<TimelineEvent>& out) {
+    sent.drain([&](const TimelineEvent& event) { out.push_back(event); });
+}
+
+std::int64_t MidiDispatcher::dispatchUntil(std::int64_t songNanos) {
+    if (filter != nullptr && filter->version() != filterVersion) {
+        applyTrackFilter();
+    }
+
+    std::int64_t lap = 0;
+    std::int64_t songMicros = loop.wrap(songNanos / 1000 - offset, lap);
+    if (lap != firedLap) {
+        wrapLoop();
+        firedLap = lap;
+    }
+
+    // Como mucho dos vueltas: tras enviar lo que toca, lo siguiente ya es posterior
+    while (true) {
+        // Lo siguiente que toca en la canción: el próximo evento o el final del bucle
+        std::int64_t nextMicros = -1;
+        if (stream != nullptr) {
+            if (nextStreamEvent()) {
+                nextMicros = tempoMap.tickToMicros(streamNext.tick);
+            } else if (!streamEnded) {
+                // El lector aún no ha dejado el siguiente evento: volver a mirar en un rato
+                return songNanos + MAX_SLEEP_NANOS;
+            }
+        } else if (!timeline.finished()) {
+            nextMicros = tempoMap.tickToMicros(timeline[timeline.position()].tick);
+        }
+        if (loop.active() && (nextMicros < 0 || nextMicros >= loop.endMicrosInSong())) {
+            nextMicros = loop.endMicrosInSong();
+        }
+        if (nextMicros < 0) {
+            return -1;
+        }
+
+        // Cuándo llegará el reloj ahí (las vueltas ya dadas cuentan)
+        std::int64_t dueNanos = (nextMicros + lap * loop.lengthMicros() + offset) * 1000;
+        if (songNanos < dueNanos) {
+            return dueNanos;
+        }
+
+        // Enviar todo lo que ya toca (acordes y eventos del mismo tick salen juntos)
+        if (stream != nullptr) {
+            advanceStream(songMicros, true);
+        }
+        firedTick = tempoMap.microsToTick(songMicros);
+        timeline.advance(firedTick, [&](const TimelineEvent& event) { emit(event); });
+        flush();
+    }
+}
+
+void MidiDispatcher::dispatchLoop() {
+    // Prioridad de tiempo real si el sistema lo permite; sin privilegios sigue con la normal
+    sched_param param;
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    while (!stopping) {
+        std::int64_t dueNanos = dispatchUntil(clock.nanos());
+        if (dueNanos < 0) {
+            break;
+        }
+
+        // Dormir hasta que el reloj llegue ahí, en tramos cortos
+        std::int64_t wake = PlaybackClock::steadyNanos() + MAX_SLEEP_NANOS;
+        std::int64_t dueWall = 0;
+        if (clock.wallTimeFor(dueNanos, dueWall)) {
+            wake = std::min(wake, dueWall);
+        }
+        sleepUntil(wake);
+    }
+    done = true;
+}
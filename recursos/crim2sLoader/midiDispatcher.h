@@ -0,0 +1,141 @@
+// midiDispatcher.h
+
+#pragma once
+#include "crim2sStream.h"
+#include "loopRegion.h"
+#include "midiSink.h"
+#include "playbackClock.h"
+#include "spscRing.h"
+#include "tempoMap.h"
+#include "timeline.h"
+#include "trackFilter.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+// Hilo de envío MIDI independiente del bucle de dibujo. Sigue el PlaybackClock
+// compartido con el dibujo: duerme con clock_nanosleep hasta el instante exacto
+// del siguiente evento, envía en una ráfaga todo lo de ese tick y lo deja en una cola sin
+// bloqueos para que el dibujo refleje el estado; el tempo audible ya no depende de
+// los FPS y el dibujo nunca puede frenar el envío.
+class MidiDispatcher {
+public:
+    // offsetMicros retrasa todos los eventos (p. ej. lo que tarda una nota en llegar a
+    // la línea de activación)
+    MidiDispatcher(Timeline timeline, TempoMap tempoMap, PlaybackClock& clock, MidiSink& sink,
+                   std::int64_t offsetMicros = 0);
+    ~MidiDispatcher();
+
+    MidiDispatcher(const MidiDispatcher&) = delete;
+    MidiDispatcher& operator=(const MidiDispatcher&) = delete;
+
+    // Arranca el hilo desde el principio de la línea de tiempo; el reloj lo arranca quien lo posee.
+    // En streaming solo se arranca una vez: el archivo no vuelve atrás.
+    void start();
+    void stop();
+
+    // Salta a songNanos del reloj: para el hilo, apaga las notas que sonaban, mueve
+    // el reloj (PlaybackClock::seek), envía el note_on de las que suenan en la nueva
+    // posición y sigue desde ahí. El hilo está parado mientras el reloj se mueve, así
+    // que nunca ve la nueva posición con la línea de tiempo en la anterior. Los
+    // eventos enviados también llegan a drain(), así que el dibujo puede rehacer su
+    // estado con ellos. Lo llama el mismo hilo que start/stop. En streaming solo salta
+    // hacia delante (lo de en medio se lee sin enviarlo); un salto atrás no hace nada.
+    void seek(std::int64_t songNanos);
+
+    // Repite la región del bucle (inactiva = sin bucle). Precalcula los note_off de
+    // las notas que cruzan el final, los note_on de las que cruzan el inicio y la
+    // posición de la línea de tiempo en él, así que dar la vuelta no busca nada.
+    // Se llama con el hilo parado.
+    void setLoop(const LoopRegion& region);
+
+    // Silencio y solo en vivo: los eventos de lo silenciado no se envían ni llegan a
+    // drain(). Al cambiar el filtro se apagan (o encienden) las notas afectadas que
+    // suenan en ese momento. Se llama con el hilo parado; filter debe seguir vivo.
+    void setTrackFilter(const TrackFilter& filter);
+
+    // Toca los eventos de stream en lugar de la línea de tiempo (que queda vacía): el
+    // lector los deja en una cola sin bloqueos de este dispatcher y el hilo de envío los
+    // saca a su hora, aplicando los set_tempo según llegan. Al destruirse cierra stream,
+    // que deja de usar la cola. Se llama con el hilo parado, antes de start().
+    void setStream(Crim2sStream& stream);
+
+    // Un paso del envío con el reloj en songNanos: aplica los cambios del filtro, da
+    // la vuelta al bucle y envía todo lo que ya toca. Devuelve la posición del reloj
+    // en que toca lo siguiente, o -1 si la canción ha terminado. Es lo que hace el
+    // hilo en cada vuelta; la reproducción sin ventana lo llama con un reloj simulado.
+    // Solo con el hilo parado.
+    std::int64_t dispatchUntil(std::int64_t songNanos);
+
+    // Añade a out los eventos enviados desde la última llamada (para el dibujo).
+    // Solo debe llamarla un hilo.
+    void drain(std::vector<TimelineEvent>& out);
+
+    bool finished() const { return done; }
+
+    // Eventos que no llegaron al dibujo porque la cola estaba llena (el MIDI sí se envió)
+    std::uint64_t droppedEvents() const { return dropped; }
+
+    // Coste del envío: mensajes enviados y tiempo total dentro de MidiSink::send
+    std::uint64_t sentMessages() const { return messagesSent; }
+    std::uint64_t sendNanos() const { return nanosSending; }
+    void printSendStats(std::ostream& out) const;
+
+private:
+    void launch();
+    void dispatchLoop();
+    void wrapLoop();
+    void applyTrackFilter();
+    void soundingNow(std::vector<TimelineEvent>& out) const;
+    bool nextStreamEvent();
+    bool advanceStream(std::int64_t songMicros, bool send);
+    void emit(const TimelineEvent& event);
+    void append(const TimelineEvent& event);
+    void flush();
+
+    Timeline timeline;
+    TempoMap tempoMap;
+    PlaybackClock& clock;
+    MidiSink& sink;
+    std::int64_t offset;
+    std::int64_t firedTick = -1; // Último tick hasta el que se ha enviado
+    std::int64_t firedLap = 0;   // Vueltas al bucle ya enviadas
+
+    LoopRegion loop;
+    std::vector<TimelineEvent> loopExit;  // note_off de lo que suena al final del bucle
+    std::vector<TimelineEvent> loopEntry; // note_on de lo que suena en su inicio
+    std::size_t loopEntryPosition = 0;
+
+    const TrackFilter* filter = nullptr;
+    std::uint64_t filterVersion = 0;
+    TrackMask mask; // Copia propia: comprobar cada evento no toca memoria compartida
+
+    // Streaming: la cola la llena el hilo lector de stream y la vacía el de envío
+    Crim2sStream* stream = nullptr;
+    std::unique_ptr<StreamQueue> streamQueue;
+    StreamEvent streamNext{};                  // Siguiente nota ya sacada de la cola
+    bool hasStreamNext = false;
+    bool streamEnded = false;                  // El archivo terminó y la cola está vacía
+    std::vector<TimelineEvent> streamSounding; // note_on de lo que suena (para silenciar y saltar)
+
+    std::thread dispatcher;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> done{false};
+
+    // Capacidad para varios segundos de eventos aunque el dibujo se detenga
+    static const std::size_t SENT_CAPACITY = 8192;
+    SpscRing<TimelineEvent, SENT_CAPACITY> sent;
+    std::atomic<std::uint64_t> dropped{0};
+
+    // Ráfaga en curso: mensajes del mismo tick pendientes de enviar
+    static const std::size_t BURST_CAPACITY = 128;
+    MidiMessage burst[BURST_CAPACITY];
+    TimelineEvent burstEvents[BURST_CAPACITY];
+    std::size_t burstSize = 0;
+    int burstTick = 0;
+    std::atomic<std::uint64_t> messagesSent{0};
+    std::atomic<std::uint64_t> nanosSending{0};
+};
@@ -0,0 +1,185 @@
+// midiRouter.cpp
+
+#include "midiRouter.h"
+#include "commandLine.h"
+#include <functional>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+
+namespace {
+
+// Entero no negativo sin nada detrás; -1 si no lo es
+long parseIndex(const std::string& text) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos || text.size() > 9) {
+        return -1;
+    }
+    return std::stol(text);
+}
+
+} // namespace
+
+void RoutingTable::set(int track, MidiRoute route) {
+    if (track >= static_cast<int>(routes.size())) {
+        routes.resize(track + 1);
+    }
+    routes[track] = route;
+}
+
+MidiRoute RoutingTable::route(int track) const {
+    if (track < static_cast<int>(routes.size()) && routes[track].port >= 0) {
+        return routes[track];
+    }
+    MidiRoute route;
+    route.port = track % portCount;
+    return route;
+}
+
+bool parseRoutingTable(const std::string& text, RoutingTable& table) {
+    std::istringstream entries(text);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        std::size_t equals = entry.find('=');
+        std::size_t colon = entry.find(':', equals);
+        long track = -1;
+        MidiRoute route;
+        if (equals != std::string::npos) {
+            track = parseIndex(entry.substr(0, equals));
+            route.port = static_cast<int>(parseIndex(entry.substr(equals + 1, colon - equals - 1)));
+            if (colon != std::string::npos) {
+                route.channel = static_cast<int>(parseIndex(entry.substr(colon + 1)));
+            }
+        }
+        if (track < 0 || route.port < 0 || (colon != std::string::npos && route.channel < 0)) {
+            std::cerr << "Error: ruta no válida '" << entry << "' (usa pista=puerto o pista=puerto:canal)" << std::endl;
+            return false;
+        }
+        if (route.port >= table.ports() || route.channel > 15) {
+            std::cerr << "Error: la ruta '" << entry << "' pide el puerto " << route.port << " de " << table.ports()
+                      << " o un canal fuera de 0-15" << std::endl;
+            return false;
+        }
+        table.set(static_cast<int>(track), route);
+    }
+    return true;
+}
+
+bool takeMidiOutputOptions(int& argc, char* argv[], MidiOutputOptions& options) {
+    std::string portsText;
+    if (takeOption(argc, argv, "--ports", portsText)) {
+        long ports = parseIndex(portsText);
+        if (ports < 1 || ports > 64) {
+            std::cerr << "Error: --ports necesita un número de puertos entre 1 y 64" << std::endl;
+            return false;
+        }
+        options.ports = static_cast<int>(ports);
+    }
+    options.virtualPorts = takeFlag(argc, argv, "--virtual");
+    options.routing = RoutingTable(options.ports);
+
+    std::string routesText;
+    if (takeOption(argc, argv, "--routes", routesText)) {
+        return parseRoutingTable(routesText, options.routing);
+    }
+    return true;
+}
+
+MidiRouter::MidiRouter(std::vector<MidiSink*> sinks, RoutingTable table) : table(std::move(table)) {
+    for (MidiSink* sink : sinks) {
+        ports.push_back(std::unique_ptr<Port>(new Port()));
+        ports.back()->sink = sink;
+    }
+    touched.assign(ports.size(), false);
+    direct.reserve(BATCH_CAPACITY);
+    if (ports.size() > 1) {
+        for (std::unique_ptr<Port>& port : ports) {
+            port->worker = std::thread(&MidiRouter::work, this, std::ref(*port));
+        }
+    }
+}
+
+MidiRouter::~MidiRouter() {
+    stopping = true;
+    for (std::unique_ptr<Port>& port : ports) {
+        if (port->worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(port->mutex);
+            }
+            port->wake.notify_one();
+            port->worker.join();
+        }
+    }
+}
+
+void MidiRouter::send(const MidiMessage* messages, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        MidiMessage message = messages[i];
+        MidiRoute route = table.route(message.track);
+        if (route.channel >= 0) {
+            message.bytes[0] = static_cast<unsigned char>((message.bytes[0] & 0xF0) | route.channel);
+        }
+        if (ports.size() == 1) {
+            direct.push_back(message);
+            continue;
+        }
+        // Cola llena: esperar al hilo del puerto antes que perder un note_off
+        Port& port = *ports[route.port];
+        while (!port.queue.push(message)) {
+            std::this_thread::yield();
+        }
+        touched[route.port] = true;
+    }
+
+    if (ports.size() == 1) {
+        ports[0]->sink->send(direct.data(), direct.size());
+        ports[0]->sent.fetch_add(direct.size(), std::memory_order_relaxed);
+        direct.clear();
+        return;
+    }
+    // Un solo aviso por puerto y ráfaga
+    for (std::size_t p = 0; p < ports.size(); ++p) {
+        if (touched[p]) {
+            touched[p] = false;
+            {
+                std::lock_guard<std::mutex> lock(ports[p]->mutex);
+                ports[p]->pending = true;
+            }
+            ports[p]->wake.notify_one();
+        }
+    }
+}
+
+void MidiRouter::work(Port& port) {
+    // Misma prioridad que el hilo de despacho, si el sistema lo permite
+    sched_param param;
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    MidiMessage batch[BATCH_CAPACITY];
+    while (true) {
+        std::size_t size = 0;
+        while (size < BATCH_CAPACITY && port.queue.pop(batch[size])) {
+            ++size;
+        }
+        if (size > 0) {
+            port.sink->send(batch, size);
+            port.sent.fetch_add(size, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Cola vacía: dormir hasta la próxima ráfaga; al parar, salir ya vacía
+        std::unique_lock<std::mutex> lock(port.mutex);
+        port.wake.wait(lock, [&] { return port.pending || stopping; });
+        if (!port.pending) {
+            break;
+        }
+        port.pending = false;
+    }
+}
+
+void MidiRouter::printPortStats(std::ostream& out) const {
+    for (std::size_t p = 0; p < ports.size(); ++p) {
+        out << "Puerto MIDI " << p << ": " << ports[p]->sent << " mensajes" << std::endl;
+    }
+}
@@ -0,0 +1,91 @@
+// midiRouter.h
+
+#pragma once
+#include "midiSink.h"
+#include "spscRing.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Destino de una pista: puerto de salida y canal (-1 conserva el del archivo)
+struct MidiRoute {
+    int port = -1;
+    int channel = -1;
+};
+
+// Tabla pista -> puerto y canal. Las pistas sin entrada van al puerto
+// pista % ports con su canal original: la carga se reparte sin tocar los canales.
+class RoutingTable {
+public:
+    explicit RoutingTable(int ports = 1) : portCount(ports) {}
+
+    int ports() const { return portCount; }
+    void set(int track, MidiRoute route);
+    MidiRoute route(int track) const;
+
+private:
+    int portCount;
+    std::vector<MidiRoute> routes; // Por pista; port -1 si no tiene entrada
+};
+
+// Interpreta "pista=puerto[:canal],..." (todo desde 0), p. ej. "0=0,1=1:9,2=1:3".
+// Escribe el error en std::cerr.
+bool parseRoutingTable(const std::string& text, RoutingTable& table);
+
+// Opciones de salida MIDI de los visores: --ports N, --virtual y --routes tabla
+struct MidiOutputOptions {
+    int ports = 1;
+    bool virtualPorts = false;
+    RoutingTable routing;
+};
+
+// Quita las opciones de argv (ver commandLine.h). Escribe el error en std::cerr.
+bool takeMidiOutputOptions(int& argc, char* argv[], MidiOutputOptions& options);
+
+// Reparte los mensajes entre puertos según su pista y les pone el canal de la
+// tabla. Cada puerto tiene su cola y su hilo de envío: un puerto lento no retrasa
+// a los demás y el orden se mantiene dentro de cada puerto. Con un solo puerto se
+// envía en el mismo hilo, sin el salto a otro.
+// send() admite un solo hilo a la vez (el de despacho, o el principal con él parado).
+class MidiRouter : public MidiSink {
+public:
+    MidiRouter(std::vector<MidiSink*> sinks, RoutingTable table);
+    ~MidiRouter() override;
+
+    MidiRouter(const MidiRouter&) = delete;
+    MidiRouter& operator=(const MidiRouter&) = delete;
+
+    void send(const MidiMessage* messages, std::size_t count) override;
+
+    // Mensajes que ha enviado cada puerto
+    void printPortStats(std::ostream& out) const;
+
+private:
+    static const std::size_t QUEUE_CAPACITY = 4096;
+    static const std::size_t BATCH_CAPACITY = 128;
+
+    struct Port {
+        MidiSink* sink = nullptr;
+        SpscRing<MidiMessage, QUEUE_CAPACITY> queue;
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool pending = false; // Hay mensajes nuevos (protegido por mutex)
+        std::atomic<std::uint64_t> sent{0};
+    };
+
+    void work(Port& port);
+
+    std::vector<std::unique_ptr<Port>> ports;
+    RoutingTable table;
+    std::atomic<bool> stopping{false};
+    std::vector<MidiMessage> direct;  // Ráfaga ya encaminada, con un solo puerto
+    std::vector<bool> touched;        // Puertos con mensajes en esta ráfaga
+};
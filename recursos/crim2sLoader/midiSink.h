@@ -0,0 +1,51 @@
+// midiSink.h
+
+#pragma once
+#include "timeline.h"
+#include <cstddef>
+#include <cstdint>
+
+// Mensaje MIDI de canal de tamaño fijo: vive en la pila, sin memoria dinámica.
+// track es la pista de origen, para repartir los mensajes entre puertos.
+struct MidiMessage {
+    unsigned char bytes[3];
+    std::uint8_t size;
+    std::uint16_t track;
+};
+
+// Velocidad de los note_off: el archivo no guarda la velocidad de liberación
+const unsigned char NOTE_OFF_VELOCITY = 64;
+
+inline MidiMessage noteMessage(bool noteOn, int channel, int note, int velocity, int track = 0) {
+    MidiMessage message;
+    message.bytes[0] = static_cast<unsigned char>((noteOn ? 0x90 : 0x80) | (channel & 0x0F));
+    message.bytes[1] = static_cast<unsigned char>(note & 0x7F);
+    message.bytes[2] = noteOn ? static_cast<unsigned char>(velocity & 0x7F) : NOTE_OFF_VELOCITY;
+    message.size = 3;
+    message.track = static_cast<std::uint16_t>(track);
+    return message;
+}
+
+// note_on/note_off de un evento con su canal y velocidad reales
+inline MidiMessage noteMessage(const TimelineEvent& event) {
+    return noteMessage(event.noteOn, event.channel, event.note, event.velocity, event.track);
+}
+
+// Destino de los mensajes MIDI. send recibe de una vez todos los mensajes que
+// tocan en el mismo tick (un acorde sale como una sola ráfaga).
+class MidiSink {
+public:
+    virtual ~MidiSink() = default;
+    virtual void send(const MidiMessage* messages, std::size_t count) = 0;
+};
+
+// Descarta los mensajes: para medir el planificador sin puerto MIDI
+class NullMidiSink : public MidiSink {
+public:
+    void send(const MidiMessage* messages, std::size_t count) override {
+        (void)messages;
+        received += count;
+    }
+
+    std::uint64_t received = 0;
+};
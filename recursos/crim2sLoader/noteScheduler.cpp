@@ -0,0 +1,44 @@
+// noteScheduler.cpp
+
+#include "noteScheduler.h"
+#include <algorithm>
+
+void NoteScheduler::reset(const Track& track) {
+    notes = &track.notes;
+    order.resize(track.notes.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    // Las pistas leídas ya vienen ordenadas por inicio; solo se ordena si no lo están
+    auto byStart = [&](std::size_t a, std::size_t b) {
+        return track.notes[a].startTime < track.notes[b].startTime;
+    };
+    if (!std::is_sorted(order.begin(), order.end(), byStart)) {
+        std::stable_sort(order.begin(), order.end(), byStart);
+    }
+    next = 0;
+    ending = {};
+
+    std::vector<Interval> spans;
+    spans.reserve(track.notes.size());
+    for (const NoteEvent& note : track.notes) {
+        spans.push_back({note.startTime, note.endTime});
+    }
+    sounding.build(spans);
+}
+
+std::size_t NoteScheduler::firstAfter(std::int64_t tick) const {
+    auto after = std::upper_bound(order.begin(), order.end(), tick,
+                                  [&](std::int64_t t, std::size_t index) { return t < (*notes)[index].startTime; });
+    return static_cast<std::size_t>(after - order.begin());
+}
+
+void NoteScheduler::setLoop(std::int64_t startTick) {
+    loopNext = firstAfter(startTick);
+    loopSounding.clear();
+    std::vector<std::size_t> found;
+    sounding.stab(startTick, found);
+    for (std::size_t index : found) {
+        loopSounding.push_back({(*notes)[index].endTime, index});
+    }
+}
@@ -0,0 +1,103 @@
+// noteScheduler.h
+
+#pragma once
+#include "crim2sLoader.h"
+#include "intervalIndex.h"
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Planificador de notas de una pista. Guarda un cursor sobre las notas ordenadas
+// por inicio y un montículo de mínimos con el final de las notas que suenan, así
+// que cada fotograma solo toca los eventos que se disparan en él.
+class NoteScheduler {
+public:
+    NoteScheduler() = default;
+    explicit NoteScheduler(const Track& track) { reset(track); }
+
+    // Vuelve al principio de la pista; las notas no deben cambiar mientras se usa
+    void reset(const Track& track);
+
+    // Dispara, en orden de tiempo, los note_on (onStart) y note_off (onEnd) con
+    // tick <= now. A igual tick, los note_off van antes que los note_on.
+    template <typename OnStart, typename OnEnd>
+    void advance(std::int64_t now, OnStart onStart, OnEnd onEnd);
+
+    // Salta al tick dado sin disparar lo anterior: las notas que suenan en él
+    // (start <= tick < end) pasan a activas y se entregan a onStart
+    template <typename OnStart>
+    void seek(std::int64_t tick, OnStart onStart);
+
+    // Precalcula el estado en el inicio de un bucle (el de seek(startTick)) para
+    // que wrap() lo restaure sin buscar
+    void setLoop(std::int64_t startTick);
+
+    // Vuelve al inicio del bucle: las notas que suenan en él pasan a activas y se
+    // entregan a onStart. Quien llama ya ha soltado las anteriores.
+    template <typename OnStart>
+    void wrap(OnStart onStart);
+
+    // Notas que han empezado y aún no han terminado
+    std::size_t activeCount() const { return ending.size(); }
+    bool finished() const { return next == order.size() && ending.empty(); }
+
+private:
+    typedef std::pair<int, std::size_t> Ending; // (endTime, índice de la nota)
+
+    // Posición en order de la primera nota con startTime > tick
+    std::size_t firstAfter(std::int64_t tick) const;
+
+    const std::vector<NoteEvent>* notes = nullptr;
+    std::vector<std::size_t> order; // Índices de las notas ordenados por startTime
+    std::size_t next = 0;
+    std::priority_queue<Ending, std::vector<Ending>, std::greater<Ending>> ending;
+    IntervalIndex sounding; // Intervalos [startTime, endTime) de las notas, para seek
+
+    // Estado precalculado en el inicio del bucle
+    std::size_t loopNext = 0;
+    std::vector<Ending> loopSounding;
+};
+
+template <typename OnStart, typename OnEnd>
+void NoteScheduler::advance(std::int64_t now, OnStart onStart, OnEnd onEnd) {
+    while (true) {
+        bool canStart = next < order.size() && (*notes)[order[next]].startTime <= now;
+        bool canEnd = !ending.empty() && ending.top().first <= now;
+        if (canEnd && (!canStart || ending.top().first <= (*notes)[order[next]].startTime)) {
+            std::size_t index = ending.top().second;
+            ending.pop();
+            onEnd((*notes)[index]);
+        } else if (canStart) {
+            std::size_t index = order[next++];
+            const NoteEvent& note = (*notes)[index];
+            ending.push({note.endTime, index});
+            onStart(note);
+        } else {
+            return;
+        }
+    }
+}
+
+template <typename OnStart>
+void NoteScheduler::seek(std::int64_t tick, OnStart onStart) {
+    next = firstAfter(tick);
+    ending = {};
+    std::vector<std::size_t> found;
+    sounding.stab(tick, found);
+    for (std::size_t index : found) {
+        const NoteEvent& note = (*notes)[index];
+        ending.push({note.endTime, index});
+        onStart(note);
+    }
+}
+
+template <typename OnStart>
+void NoteScheduler::wrap(OnStart onStart) {
+    next = loopNext;
+    ending = std::priority_queue<Ending, std::vector<Ending>, std::greater<Ending>>(std::greater<Ending>(), loopSounding);
+    for (const Ending& active : loopSounding) {
+        onStart((*notes)[active.second]);
+    }
+}
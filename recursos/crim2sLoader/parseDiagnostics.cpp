@@ -0,0 +1,52 @@
+// parseDiagnostics.cpp
+
+#include "parseDiagnostics.h"
+#include <sstream>
+
+namespace {
+
+const char* issueName(int issue) {
+    switch (static_cast<ParseIssue>(issue)) {
+        case ParseIssue::InvalidTrack: return "Índice de pista inválido";
+        case ParseIssue::UnmatchedNoteOff: return "Nota_off sin nota_on correspondiente";
+        case ParseIssue::MalformedLine: return "Línea no reconocida";
+        default: return "Otro";
+    }
+}
+
+} // namespace
+
+std::uint64_t ParseDiagnostics::total() const {
+    std::uint64_t sum = 0;
+    for (const Category& category : categories) {
+        sum += category.count;
+    }
+    return sum;
+}
+
+void ParseDiagnostics::clear() {
+    for (Category& category : categories) {
+        category = Category();
+    }
+}
+
+void ParseDiagnostics::printSummary(std::ostream& out, const std::string& source) const {
+    if (total() == 0) {
+        return;
+    }
+    // Se compone todo el texto y se escribe de una vez
+    std::ostringstream text;
+    text << "Avisos al leer " << source << ":\n";
+    for (int i = 0; i < static_cast<int>(ParseIssue::Count); ++i) {
+        const Category& category = categories[i];
+        if (category.count == 0) continue;
+        text << "  " << issueName(i) << ": " << category.count << "\n";
+        for (const Sample& sample : category.samples) {
+            text << "    [" << sample.position << "] " << sample.text << "\n";
+        }
+        if (category.count > category.samples.size()) {
+            text << "    ... y " << (category.count - category.samples.size()) << " más\n";
+        }
+    }
+    out << text.str();
+}
@@ -0,0 +1,53 @@
+// parseDiagnostics.h
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Tipos de problema que se encuentran al leer una canción
+enum class ParseIssue {
+    InvalidTrack,     // Índice de pista fuera de rango
+    UnmatchedNoteOff, // note_off sin note_on abierto
+    MalformedLine,    // Línea que no es un evento reconocible
+    Count
+};
+
+// Contabilidad de problemas de lectura. En el bucle de lectura solo se incrementa
+// un contador y, para las primeras maxSamples apariciones de cada tipo, se copia
+// la línea; el resumen se escribe una sola vez al terminar.
+class ParseDiagnostics {
+public:
+    explicit ParseDiagnostics(std::size_t maxSamples = 5) : maxSamples(maxSamples) {}
+
+    // Registra un problema; position es el byte (o tick) donde aparece
+    void report(ParseIssue issue, std::uint64_t position, std::string_view text) {
+        Category& category = categories[static_cast<int>(issue)];
+        if (category.count++ < maxSamples) {
+            category.samples.push_back({position, std::string(text)});
+        }
+    }
+
+    std::uint64_t count(ParseIssue issue) const { return categories[static_cast<int>(issue)].count; }
+    std::uint64_t total() const;
+    void clear();
+
+    // Escribe el resumen de una vez (sin vaciar el flujo); no escribe nada si no hubo problemas
+    void printSummary(std::ostream& out, const std::string& source) const;
+
+private:
+    struct Sample {
+        std::uint64_t position;
+        std::string text;
+    };
+    struct Category {
+        std::uint64_t count = 0;
+        std::vector<Sample> samples;
+    };
+
+    std::size_t maxSamples;
+    Category categories[static_cast<int>(ParseIssue::Count)];
+};
@@ -0,0 +1,116 @@
+// playbackClock.cpp
+
+#include "playbackClock.h"
+#include <chrono>
+
+std::int64_t PlaybackClock::steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PlaybackClock::State PlaybackClock::load() const {
+    State state;
+    std::uint32_t before;
+    std::uint32_t after;
+    do {
+        before = sequence.load(std::memory_order_acquire);
+        state.anchorWall = anchorWall.load(std::memory_order_relaxed);
+        state.anchorSong = anchorSong.load(std::memory_order_relaxed);
+        state.rate = rateFixed.load(std::memory_order_relaxed);
+        state.running = running.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence.load(std::memory_order_relaxed);
+    } while (before != after || (before & 1) != 0);
+    return state;
+}
+
+void PlaybackClock::store(const State& state) {
+    // Número impar mientras se escribe: los lectores reintentan
+    std::uint32_t version = sequence.load(std::memory_order_relaxed);
+    sequence.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    anchorWall.store(state.anchorWall, std::memory_order_relaxed);
+    anchorSong.store(state.anchorSong, std::memory_order_relaxed);
+    rateFixed.store(state.rate, std::memory_order_relaxed);
+    running.store(state.running, std::memory_order_relaxed);
+    sequence.store(version + 2, std::memory_order_release);
+}
+
+std::int64_t PlaybackClock::songAt(const State& state, std::int64_t wall) {
+    if (!state.running) {
+        return state.anchorSong;
+    }
+    // 128 bits para que el producto no desborde en sesiones de horas
+    __int128 elapsed = static_cast<__int128>(wall - state.anchorWall) * state.rate;
+    return state.anchorSong + static_cast<std::int64_t>(elapsed / RATE_ONE);
+}
+
+void PlaybackClock::start() {
+    State state = load();
+    state.anchorWall = steadyNanos();
+    state.anchorSong = 0;
+    state.running = true;
+    store(state);
+}
+
+void PlaybackClock::pause() {
+    State state = load();
+    if (!state.running) {
+        return;
+    }
+    std::int64_t now = steadyNanos();
+    state.anchorSong = songAt(state, now);
+    state.anchorWall = now;
+    state.running = false;
+    store(state);
+}
+
+void PlaybackClock::resume() {
+    State state = load();
+    if (state.running) {
+        return;
+    }
+    state.anchorWall = steadyNanos();
+    state.running = true;
+    store(state);
+}
+
+void PlaybackClock::seek(std::int64_t songNanos) {
+    State state = load();
+    state.anchorWall = steadyNanos();
+    state.anchorSong = songNanos;
+    store(state);
+}
+
+void PlaybackClock::setRate(double rate) {
+    State state = load();
+    std::int64_t now = steadyNanos();
+    state.anchorSong = songAt(state, now);
+    state.anchorWall = now;
+    state.rate = rate > 0 ? static_cast<std::int64_t>(rate * RATE_ONE + 0.5) : 0;
+    store(state);
+}
+
+double PlaybackClock::rate() const {
+    return static_cast<double>(rateFixed.load(std::memory_order_relaxed)) / RATE_ONE;
+}
+
+bool PlaybackClock::paused() const {
+    return !running.load(std::memory_order_relaxed);
+}
+
+std::int64_t PlaybackClock::nanos() const {
+    return songAt(load(), steadyNanos());
+}
+
+bool PlaybackClock::wallTimeFor(std::int64_t songNanos, std::int64_t& wallNanos) const {
+    State state = load();
+    if (!state.running || state.rate <= 0) {
+        return false;
+    }
+    // Redondeo hacia arriba: al despertar en wallNanos la canción ya ha llegado
+    __int128 scaled = static_cast<__int128>(songNanos - state.anchorSong) * RATE_ONE;
+    std::int64_t delta = static_cast<std::int64_t>(scaled >= 0 ? (scaled + state.rate - 1) / state.rate : scaled / state.rate);
+    wallNanos = state.anchorWall + delta;
+    return true;
+}
@@ -0,0 +1,60 @@
+// playbackClock.h
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Reloj de reproducción en nanosegundos enteros sobre std::chrono::steady_clock
+// (CLOCK_MONOTONIC en Linux, el mismo que usa el hilo de envío MIDI). Guarda un
+// ancla (instante real, posición en la canción) y la velocidad; la posición se
+// calcula siempre desde el ancla, así que no acumula error en sesiones largas.
+//
+// Un solo hilo lo controla (start, pause, resume, setRate); cualquier hilo puede
+// leerlo sin bloquearse (secuencia de versiones tipo seqlock).
+class PlaybackClock {
+public:
+    // Velocidad en punto fijo: RATE_ONE es la velocidad normal
+    static const std::int64_t RATE_ONE = 1 << 16;
+
+    // Pone la posición a cero y empieza a contar
+    void start();
+    void pause();
+    void resume();
+
+    // Salta a otra posición de la canción conservando pausa y velocidad
+    void seek(std::int64_t songNanos);
+
+    // Cambia la velocidad sin saltos en la posición (1.0 normal, 0.5 mitad...)
+    void setRate(double rate);
+    double rate() const;
+    bool paused() const;
+
+    // Posición actual en la canción
+    std::int64_t nanos() const;
+    std::int64_t micros() const { return nanos() / 1000; }
+
+    // Instante real (steadyNanos) en que la canción llegará a songNanos con la
+    // velocidad actual; false si está en pausa o con velocidad cero
+    bool wallTimeFor(std::int64_t songNanos, std::int64_t& wallNanos) const;
+
+    // Instante actual de steady_clock en nanosegundos
+    static std::int64_t steadyNanos();
+
+private:
+    struct State {
+        std::int64_t anchorWall;
+        std::int64_t anchorSong;
+        std::int64_t rate;
+        bool running;
+    };
+
+    State load() const;
+    void store(const State& state);
+    static std::int64_t songAt(const State& state, std::int64_t wall);
+
+    std::atomic<std::uint32_t> sequence{0};
+    std::atomic<std::int64_t> anchorWall{0};
+    std::atomic<std::int64_t> anchorSong{0};
+    std::atomic<std::int64_t> rateFixed{RATE_ONE};
+    std::atomic<bool> running{false};
+};
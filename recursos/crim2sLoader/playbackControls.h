@@ -0,0 +1,103 @@
+// playbackControls.h
+
+#pragma once
+#include "midiDispatcher.h"
+#include "playbackClock.h"
+#include "rateControl.h"
+#include "trackFilter.h"
+#include <SFML/Window/Event.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <rtmidi/RtMidi.h>
+#include <vector>
+
+// Mandos de reproducción comunes a todos los visores. Solo cabecera, como
+// rtMidiSink.h: la biblioteca del cargador no depende de SFML ni de RtMidi.
+//
+//   Flechas arriba/abajo, 1: más rápido, más lento, velocidad normal
+//   Flechas izquierda/derecha, Inicio: saltar ±5 s, volver al principio
+//   F1-F12: silencia las pistas 0-11 (Mayús: solo; Ctrl: el canal en vez de la pista)
+//
+// La velocidad también sigue al controlador RateControl::RATE_CONTROLLER de la
+// primera entrada MIDI, si la hay.
+class PlaybackControls {
+public:
+    static constexpr std::int64_t SEEK_STEP_NANOS = 5000000000LL;
+
+    PlaybackControls(PlaybackClock& clock, MidiDispatcher& dispatcher, TrackFilter& trackFilter)
+        : clock(clock), dispatcher(dispatcher), trackFilter(trackFilter), rateControl(clock) {
+        if (midiin.getPortCount() > 0) {
+            midiin.openPort(0);
+            midiin.setCallback([](double, std::vector<unsigned char>* message, void* control) {
+                static_cast<RateControl*>(control)->midiMessage(*message);
+            }, &rateControl);
+        }
+    }
+
+    // El callback de entrada guarda la dirección de rateControl
+    PlaybackControls(const PlaybackControls&) = delete;
+    PlaybackControls& operator=(const PlaybackControls&) = delete;
+
+    // Atiende una tecla. Devuelve true si ha saltado o cambiado el silencio: los
+    // visores que dibujan lo que suena (no lo enviado) deben rehacerlo. En streaming
+    // el dispatcher solo salta hacia delante.
+    bool keyPressed(const sf::Event::KeyEvent& key) {
+        if (key.code == sf::Keyboard::Up) {
+            rateControl.faster();
+        } else if (key.code == sf::Keyboard::Down) {
+            rateControl.slower();
+        } else if (key.code == sf::Keyboard::Num1) {
+            rateControl.reset();
+        }
+
+        std::int64_t target = -1;
+        if (key.code == sf::Keyboard::Left) {
+            target = std::max<std::int64_t>(0, clock.nanos() - SEEK_STEP_NANOS);
+        } else if (key.code == sf::Keyboard::Right) {
+            target = clock.nanos() + SEEK_STEP_NANOS;
+        } else if (key.code == sf::Keyboard::Home) {
+            target = 0;
+        }
+        if (target >= 0) {
+            dispatcher.seek(target);
+            return true;
+        }
+
+        if (key.code >= sf::Keyboard::F1 && key.code <= sf::Keyboard::F12) {
+            trackFilter.toggle(key.code - sf::Keyboard::F1, key.shift, key.control);
+            return true;
+        }
+        return false;
+    }
+
+    // Una vez por fotograma: cambios de velocidad llegados por MIDI
+    void apply() { rateControl.apply(); }
+
+private:
+    PlaybackClock& clock;
+    MidiDispatcher& dispatcher;
+    TrackFilter& trackFilter;
+    RateControl rateControl;
+    RtMidiIn midiin;
+};
+
+// Ayuda de la línea de órdenes de un visor. arguments son sus argumentos propios
+// tras <bpm> (p. ej. " <mix_strategy> [--stream]") y help las líneas que los explican.
+inline void printPlaybackUsage(const char* program, const char* arguments = "",
+                               std::initializer_list<const char*> help = {}) {
+    std::cerr << "Uso: " << program << " <ruta al archivo .mid, .crim2s, .crim2b o .crim2z> <bpm>" << arguments
+              << " [--loop A:B] [--ports N] [--virtual] [--routes T] [--headless]" << std::endl;
+    std::cerr << "bpm: tempo inicial, hasta el primer cambio de tempo del archivo" << std::endl;
+    for (const char* line : help) {
+        std::cerr << line << std::endl;
+    }
+    std::cerr << "--loop A:B: repite del compás A al B (4/4), o de At a Bt en ticks" << std::endl;
+    std::cerr << "--ports N: reparte las pistas entre N puertos MIDI (la pista i al puerto i % N)" << std::endl;
+    std::cerr << "--virtual: abre puertos virtuales \"Koloreo 0\", \"Koloreo 1\"... en vez de los del sistema" << std::endl;
+    std::cerr << "--routes T: pista=puerto[:canal] separados por comas, p. ej. 0=0,1=1:9 (todo desde 0)" << std::endl;
+    std::cerr << "--headless: sin ventana ni MIDI, mide el planificador (eventos/s, polifonía, coste por tick)" << std::endl;
+    std::cerr << "Teclas: flechas arriba/abajo y 1 (velocidad), izquierda/derecha e Inicio (saltar), "
+                 "F1-F12 (silencio; Mayús solo, Ctrl canal)" << std::endl;
+}
@@ -0,0 +1,30 @@
+// rateControl.cpp
+
+#include "rateControl.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+void RateControl::midiMessage(const std::vector<unsigned char>& message) {
+    // Control change (0xBn) del controlador de velocidad
+    if (message.size() >= 3 && (message[0] & 0xF0) == 0xB0 && message[1] == RATE_CONTROLLER) {
+        pendingController.store(message[2] & 0x7F, std::memory_order_relaxed);
+    }
+}
+
+void RateControl::apply() {
+    int value = pendingController.exchange(-1, std::memory_order_relaxed);
+    if (value >= 0) {
+        // Escala exponencial: cada 32 pasos del controlador duplican o dividen la velocidad
+        set(std::pow(2.0, (value - 64) / 32.0));
+    }
+}
+
+void RateControl::set(double rate) {
+    rate = std::min(MAX_RATE, std::max(MIN_RATE, rate));
+    if (rate == clock.rate()) {
+        return;
+    }
+    clock.setRate(rate);
+    std::cout << "Velocidad: x" << clock.rate() << std::endl;
+}
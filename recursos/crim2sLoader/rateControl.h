@@ -0,0 +1,38 @@
+// rateControl.h
+
+#pragma once
+#include "playbackClock.h"
+#include <atomic>
+#include <vector>
+
+// Velocidad de reproducción en vivo sobre un PlaybackClock: teclas (más rápido,
+// más lento, normal) y un controlador MIDI (CC) de entrada. El reloj se reancla
+// en la posición actual, así que los eventos siguientes salen en orden, sin
+// releer el archivo ni saltos.
+class RateControl {
+public:
+    static constexpr double MIN_RATE = 0.25;
+    static constexpr double MAX_RATE = 4.0;
+    static constexpr double STEP = 1.1;       // Factor de cada pulsación
+    static const int RATE_CONTROLLER = 16;    // CC de propósito general 1, cualquier canal
+
+    explicit RateControl(PlaybackClock& clock) : clock(clock) {}
+
+    // Desde el hilo que controla el reloj (teclado)
+    void faster() { set(clock.rate() * STEP); }
+    void slower() { set(clock.rate() / STEP); }
+    void reset() { set(1.0); }
+
+    // Desde cualquier hilo (callback de entrada MIDI): guarda el último valor del CC
+    // para que apply() lo aplique. 0 = MIN_RATE, 64 = normal, 127 = casi MAX_RATE.
+    void midiMessage(const std::vector<unsigned char>& message);
+
+    // Aplica el valor pendiente del controlador; se llama una vez por fotograma
+    void apply();
+
+private:
+    void set(double rate);
+
+    PlaybackClock& clock;
+    std::atomic<int> pendingController{-1};
+};
@@ -0,0 +1,67 @@
+// rtMidiSink.h
+
+#pragma once
+#include "midiSink.h"
+#include <iostream>
+#include <memory>
+#include <rtmidi/RtMidi.h>
+#include <string>
+#include <vector>
+
+// Salida por un puerto de RtMidiOut. Solo cabecera: la biblioteca del cargador no
+// depende de RtMidi, la enlazan los visores.
+class RtMidiSink : public MidiSink {
+public:
+    explicit RtMidiSink(RtMidiOut& out) : out(out) {}
+
+    void send(const MidiMessage* messages, std::size_t count) override {
+        // sendMessage(puntero, tamaño) no copia el mensaje a un std::vector
+        for (std::size_t i = 0; i < count; ++i) {
+            out.sendMessage(messages[i].bytes, messages[i].size);
+        }
+    }
+
+private:
+    RtMidiOut& out;
+};
+
+// Puertos de salida para MidiRouter: los primeros puertos del sistema o, con
+// virtualPorts, puertos virtuales "Koloreo N" a los que cualquier programa de la
+// misma máquina puede conectarse (aconnect, aseqdump) para comprobar el reparto.
+class RtMidiPorts {
+public:
+    bool open(int count, bool virtualPorts) {
+        for (int i = 0; i < count; ++i) {
+            std::unique_ptr<RtMidiOut> out(new RtMidiOut());
+            if (virtualPorts) {
+                out->openVirtualPort("Koloreo " + std::to_string(i));
+            } else {
+                unsigned int available = out->getPortCount();
+                if (available == 0) {
+                    std::cout << "No hay puertos MIDI disponibles.\n";
+                    return false;
+                }
+                if (static_cast<unsigned int>(i) >= available) {
+                    std::cerr << "Error: se piden " << count << " puertos MIDI y solo hay " << available << std::endl;
+                    return false;
+                }
+                out->openPort(i);
+            }
+            portSinks.push_back(std::unique_ptr<RtMidiSink>(new RtMidiSink(*out)));
+            outs.push_back(std::move(out));
+        }
+        return true;
+    }
+
+    std::vector<MidiSink*> sinks() const {
+        std::vector<MidiSink*> result;
+        for (const std::unique_ptr<RtMidiSink>& sink : portSinks) {
+            result.push_back(sink.get());
+        }
+        return result;
+    }
+
+private:
+    std::vector<std::unique_ptr<RtMidiOut>> outs;
+    std::vector<std::unique_ptr<RtMidiSink>> portSinks;
+};
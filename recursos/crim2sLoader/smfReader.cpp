@@ -0,0 +1,219 @@
+// smfReader.cpp
+
+#include "smfReader.h"
+#include "parseDiagnostics.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+typedef const unsigned char* BytePtr;
+
+std::uint32_t readBE32(BytePtr p) {
+    return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3];
+}
+
+std::uint16_t readBE16(BytePtr p) {
+    return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+}
+
+// Lee una cantidad de longitud variable (como máximo 4 bytes)
+bool readVarLen(BytePtr& p, BytePtr end, std::uint32_t& value) {
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (p >= end) {
+            return false;
+        }
+        unsigned char byte = *p++;
+        value = (value << 7) | (byte & 0x7F);
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Número de bytes de datos de un mensaje de canal
+int channelDataBytes(unsigned char status) {
+    unsigned char type = status & 0xF0;
+    return (type == 0xC0 || type == 0xD0) ? 1 : 2;
+}
+
+// Decodifica un chunk MTrk. Solo se guardan note_on/note_off y los cambios de tempo.
+bool decodeTrack(BytePtr p, BytePtr end, int trackIndex, std::vector<MidiEvent>& events,
+                 std::vector<TempoEvent>& tempoMap) {
+    long long tick = 0;
+    unsigned char runningStatus = 0;
+
+    while (p < end) {
+        std::uint32_t delta = 0;
+        if (!readVarLen(p, end, delta) || p >= end) {
+            return false;
+        }
+        tick = std::min<long long>(tick + delta, INT_MAX);
+
+        unsigned char status = *p;
+        if (status == 0xFF) {
+            // Meta evento: tipo, longitud y datos
+            if (end - p < 2) {
+                return false;
+            }
+            unsigned char type = p[1];
+            p += 2;
+            std::uint32_t length = 0;
+            if (!readVarLen(p, end, length) || length > static_cast<std::uint32_t>(end - p)) {
+                return false;
+            }
+            if (type == 0x51 && length == 3) {
+                int microsecondsPerBeat = (p[0] << 16) | (p[1] << 8) | p[2];
+                tempoMap.push_back({static_cast<int>(tick), microsecondsPerBeat});
+            }
+            p += length;
+            if (type == 0x2F) {
+                break; // Fin de pista
+            }
+        } else if (status == 0xF0 || status == 0xF7) {
+            // SysEx: se salta el contenido
+            ++p;
+            std::uint32_t length = 0;
+            if (!readVarLen(p, end, length) || length > static_cast<std::uint32_t>(end - p)) {
+                return false;
+            }
+            p += length;
+        } else {
+            // Mensaje de canal, con o sin running status
+            if (status & 0x80) {
+                runningStatus = status;
+                ++p;
+            } else if (runningStatus == 0) {
+                return false;
+            }
+            int dataBytes = channelDataBytes(runningStatus);
+            if (end - p < dataBytes) {
+                return false;
+            }
+            unsigned char data1 = p[0];
+            unsigned char data2 = dataBytes == 2 ? p[1] : 0;
+            p += dataBytes;
+
+            unsigned char type = runningStatus & 0xF0;
+            if (type == 0x80 || type == 0x90) {
+                events.push_back({static_cast<int>(tick), trackIndex, runningStatus, data1, data2});
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// Decodifica los chunks MThd/MTrk y mezcla las pistas ya ordenadas
+bool readMidiEvents(const std::string& filename, MidiFileData& data) {
+    data = MidiFileData();
+    MappedFile file;
+    if (!file.open(filename)) {
+        std::cerr << "Error al abrir el archivo " << filename << std::endl;
+        return false;
+    }
+
+    BytePtr p = reinterpret_cast<BytePtr>(file.begin());
+    BytePtr end = reinterpret_cast<BytePtr>(file.end());
+    if (end - p < 14 || std::memcmp(p, "MThd", 4) != 0) {
+        std::cerr << "Error: " << filename << " no es un archivo MIDI estándar" << std::endl;
+        return false;
+    }
+    std::uint32_t headerLength = readBE32(p + 4);
+    if (headerLength < 6 || headerLength > static_cast<std::uint32_t>(end - p - 8)) {
+        std::cerr << "Error: cabecera MThd inválida en " << filename << std::endl;
+        return false;
+    }
+    int declaredTracks = readBE16(p + 10);
+    std::uint16_t division = readBE16(p + 12);
+    if (division & 0x8000) {
+        // División SMPTE: fotogramas por segundo x ticks por fotograma
+        int framesPerSecond = -static_cast<signed char>(division >> 8);
+        data.ticksPerBeat = framesPerSecond * (division & 0xFF);
+        std::cerr << "Advertencia: división SMPTE, se usan " << data.ticksPerBeat << " ticks por segundo" << std::endl;
+    } else {
+        data.ticksPerBeat = division;
+    }
+    p += 8 + headerLength;
+
+    // Decodificar cada MTrk; los eventos de todas las pistas quedan contiguos
+    std::vector<std::size_t> runStarts;
+    while (end - p >= 8 && data.trackCount < declaredTracks) {
+        std::uint32_t length = readBE32(p + 4);
+        bool isTrack = std::memcmp(p, "MTrk", 4) == 0;
+        p += 8;
+        if (length > static_cast<std::uint32_t>(end - p)) {
+            std::cerr << "Advertencia: chunk truncado en " << filename << std::endl;
+            length = static_cast<std::uint32_t>(end - p);
+        }
+        if (isTrack) {
+            runStarts.push_back(data.events.size());
+            if (!decodeTrack(p, p + length, data.trackCount, data.events, data.tempoMap)) {
+                std::cerr << "Advertencia: pista " << data.trackCount << " mal formada en " << filename << std::endl;
+            }
+            ++data.trackCount;
+        }
+        p += length;
+    }
+    runStarts.push_back(data.events.size());
+
+    // Mezcla k-vías in situ: cada pista ya está ordenada, así que se fusionan
+    // las series por parejas. inplace_merge es estable, por lo que a igual tick
+    // se mantiene el orden por pista (igual que el ordenado del extractor Python).
+    auto byTick = [](const MidiEvent& a, const MidiEvent& b) { return a.tick < b.tick; };
+    while (runStarts.size() > 2) {
+        std::vector<std::size_t> merged;
+        for (std::size_t i = 0; i + 1 < runStarts.size(); i += 2) {
+            merged.push_back(runStarts[i]);
+            if (i + 2 < runStarts.size()) {
+                std::inplace_merge(data.events.begin() + runStarts[i], data.events.begin() + runStarts[i + 1],
+                                   data.events.begin() + runStarts[i + 2], byTick);
+            }
+        }
+        merged.push_back(runStarts.back());
+        runStarts.swap(merged);
+    }
+
+    sortTempoMap(data.tempoMap);
+    return true;
+}
+
+// Lee un .mid y devuelve las pistas con las notas emparejadas
+std::vector<Track> readMidiFile(const std::string& filename, int& ticksPerBeat, NoteOffPairing pairing,
+                                std::vector<TempoEvent>* tempoMap, ParseDiagnostics* diagnostics) {
+    MidiFileData data;
+    if (!readMidiEvents(filename, data)) {
+        return {};
+    }
+    ticksPerBeat = data.ticksPerBeat;
+    if (tempoMap) {
+        *tempoMap = data.tempoMap;
+    }
+
+    ParseDiagnostics localDiagnostics;
+    ParseDiagnostics& issues = diagnostics ? *diagnostics : localDiagnostics;
+    std::vector<Track> tracks(data.trackCount);
+    NotePairer pairer(tracks, pairing);
+    for (const MidiEvent& event : data.events) {
+        int channel = event.status & 0x0F;
+        if ((event.status & 0xF0) == 0x90 && event.data2 > 0) {
+            pairer.noteOn(event.track, channel, event.data1, event.data2, event.tick);
+        } else if (!pairer.noteOff(event.track, channel, event.data1, event.tick)) {
+            std::string text = "Track=" + std::to_string(event.track) + " Canal=" + std::to_string(channel)
+                             + " Nota=" + std::to_string(int(event.data1));
+            issues.report(ParseIssue::UnmatchedNoteOff, static_cast<std::uint64_t>(event.tick), text);
+        }
+    }
+
+    // Establecer endTime para notas que no lo tienen
+    pairer.finish();
+    if (!diagnostics) {
+        localDiagnostics.printSummary(std::cerr, filename);
+    }
+    return tracks;
+}
@@ -0,0 +1,36 @@
+// smfReader.h
+
+#pragma once
+#include "crim2sLoader.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Evento de canal de un Standard MIDI File, con el tiempo ya acumulado en ticks
+struct MidiEvent {
+    int tick;
+    int track;
+    std::uint8_t status; // Tipo y canal (0x80..0xEF)
+    std::uint8_t data1;
+    std::uint8_t data2;
+};
+
+// Contenido decodificado de un .mid: eventos de canal de todas las pistas
+// mezclados en orden temporal (estable por pista) y mapa de tempo
+struct MidiFileData {
+    int ticksPerBeat = 480;
+    int trackCount = 0;
+    std::vector<MidiEvent> events;
+    std::vector<TempoEvent> tempoMap;
+};
+
+// Decodifica los chunks MThd/MTrk (cantidades de longitud variable, running status)
+// y mezcla las pistas ya ordenadas. Devuelve false si el archivo no es un SMF válido.
+bool readMidiEvents(const std::string& filename, MidiFileData& data);
+
+// Lee un .mid y devuelve las pistas con las notas emparejadas, igual que readCrim2sFile.
+// En los avisos de diagnostics la posición es el tick del evento.
+std::vector<Track> readMidiFile(const std::string& filename, int& ticksPerBeat,
+                                NoteOffPairing pairing = NoteOffPairing::FIFO,
+                                std::vector<TempoEvent>* tempoMap = nullptr,
+                                ParseDiagnostics* diagnostics = nullptr);
@@ -0,0 +1,104 @@
+// songCache.cpp
+
+#include "songCache.h"
+#include "contentHash.h"
+#include "crim2b.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Crea el directorio y los que falten por encima (como mkdir -p)
+bool ensureDirectory(const std::string& path) {
+    for (std::size_t pos = 1; pos <= path.size(); ++pos) {
+        if (pos == path.size() || path[pos] == '/') {
+            std::string partial = path.substr(0, pos);
+            if (mkdir(partial.c_str(), 0755) != 0 && errno != EEXIST) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::string entryPath(const std::string& directory, std::uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.crim2b", static_cast<unsigned long long>(key));
+    return directory + "/" + name;
+}
+
+} // namespace
+
+std::string songCacheDirectory() {
+    const char* custom = std::getenv("KOLOREO_CACHE_DIR");
+    if (custom != nullptr && *custom != '\0') {
+        return custom;
+    }
+    const char* home = std::getenv("HOME");
+    if (home == nullptr || *home == '\0') {
+        return "";
+    }
+    return std::string(home) + "/.cache/koloreo";
+}
+
+bool songCacheKey(const std::string& filename, std::uint64_t& key) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        return false;
+    }
+    // La versión del formato entra en la clave: al cambiarla se ignoran las entradas viejas
+    key = contentHash(file.begin(), file.size(), HASH_SEED + CRIM2B_VERSION);
+    return true;
+}
+
+std::vector<Track> loadSongCached(const std::string& filename, int& ticksPerBeat,
+                                  std::vector<TempoEvent>* tempoMap, SongParser parse) {
+    std::string directory = songCacheDirectory();
+    std::uint64_t key = 0;
+    if (std::getenv("KOLOREO_NO_CACHE") != nullptr || directory.empty() || !songCacheKey(filename, key)) {
+        return parse(filename, ticksPerBeat, tempoMap);
+    }
+    std::string path = entryPath(directory, key);
+
+    // Acierto: las columnas ya están emparejadas, no hay nada que analizar
+    if (access(path.c_str(), F_OK) == 0) {
+        Crim2bSong song;
+        if (song.open(path) && song.verifyChecksum()) {
+            ticksPerBeat = song.ticksPerBeat();
+            if (tempoMap) {
+                *tempoMap = song.tempoMap();
+            }
+            return song.toTracks();
+        }
+        std::cerr << "Advertencia: entrada de caché corrupta, se regenera: " << path << std::endl;
+    }
+
+    // Fallo: leer el origen y guardar el resultado
+    std::vector<TempoEvent> tempo;
+    std::vector<Track> tracks = parse(filename, ticksPerBeat, &tempo);
+    if (tracks.empty() || !ensureDirectory(directory)) {
+        if (tempoMap) {
+            *tempoMap = tempo;
+        }
+        return tracks;
+    }
+
+    // Se escribe en un temporal y se renombra, así otra ejecución nunca ve una entrada a medias
+    std::string temporary = path + ".tmp" + std::to_string(getpid());
+    if (writeCrim2bFile(temporary, tracks, ticksPerBeat, tempo)) {
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+            std::remove(temporary.c_str());
+        }
+    } else {
+        std::remove(temporary.c_str());
+    }
+
+    if (tempoMap) {
+        *tempoMap = tempo;
+    }
+    return tracks;
+}
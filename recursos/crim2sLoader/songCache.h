@@ -0,0 +1,29 @@
+// songCache.h
+
+#pragma once
+#include "crim2sLoader.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Caché de canciones ya preprocesadas. Cada entrada es un .crim2b (notas
+// emparejadas, columnas de tiempo y mapa de tempo) que se llama como el hash
+// del contenido del archivo de origen, así que un origen modificado nunca
+// reutiliza una entrada antigua. Las entradas se validan con su checksum y,
+// si están corruptas, se vuelven a generar.
+
+// Lector que se usa cuando la caché no tiene una entrada válida
+typedef std::vector<Track> (*SongParser)(const std::string& filename, int& ticksPerBeat,
+                                         std::vector<TempoEvent>* tempoMap);
+
+// Directorio de la caché: $KOLOREO_CACHE_DIR o, si no está definido, ~/.cache/koloreo.
+// Devuelve una cadena vacía si no hay ninguno disponible.
+std::string songCacheDirectory();
+
+// Hash del contenido de un archivo que identifica su entrada en la caché
+bool songCacheKey(const std::string& filename, std::uint64_t& key);
+
+// Carga filename desde la caché o, si no hay entrada válida, lo lee con parse y
+// guarda el resultado. Con KOLOREO_NO_CACHE definido se lee siempre con parse.
+std::vector<Track> loadSongCached(const std::string& filename, int& ticksPerBeat,
+                                  std::vector<TempoEvent>* tempoMap, SongParser parse);
@@ -0,0 +1,42 @@
+// songFile.cpp
+
+#include "songFile.h"
+#include "crim2b.h"
+#include "crim2z.h"
+#include "smfReader.h"
+#include "songCache.h"
+
+namespace {
+
+std::vector<Track> parseMidi(const std::string& filename, int& ticksPerBeat, std::vector<TempoEvent>* tempoMap) {
+    return readMidiFile(filename, ticksPerBeat, NoteOffPairing::FIFO, tempoMap);
+}
+
+// Los volcados grandes se analizan en paralelo; los pequeños, de forma secuencial
+std::vector<Track> parseCrim2s(const std::string& filename, int& ticksPerBeat, std::vector<TempoEvent>* tempoMap) {
+    return readCrim2sFileParallel(filename, ticksPerBeat, NoteOffPairing::FIFO, 0, tempoMap);
+}
+
+} // namespace
+
+// Indica si el nombre de archivo termina con la extensión dada (p. ej. ".crim2b")
+bool hasExtension(const std::string& filename, const std::string& extension) {
+    return filename.size() >= extension.size() &&
+           filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+// Carga una canción eligiendo el lector según la extensión del archivo
+std::vector<Track> loadSongFile(const std::string& filename, int& ticksPerBeat,
+                                std::vector<TempoEvent>* tempoMap) {
+    if (hasExtension(filename, ".crim2b")) {
+        return readCrim2bFile(filename, ticksPerBeat, tempoMap);
+    }
+    if (hasExtension(filename, ".crim2z")) {
+        return readCrim2zFile(filename, ticksPerBeat, tempoMap);
+    }
+    // El resto pasa por la caché: tras la primera carga se lee el .crim2b ya emparejado
+    if (hasExtension(filename, ".mid") || hasExtension(filename, ".midi")) {
+        return loadSongCached(filename, ticksPerBeat, tempoMap, parseMidi);
+    }
+    return loadSongCached(filename, ticksPerBeat, tempoMap, parseCrim2s);
+}
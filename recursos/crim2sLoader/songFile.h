@@ -0,0 +1,17 @@
+// songFile.h
+
+#pragma once
+#include "crim2sLoader.h"
+#include <string>
+#include <vector>
+
+// Carga una canción eligiendo el lector según la extensión del archivo:
+// .mid/.midi (Standard MIDI File), .crim2b (binario), .crim2z (comprimido) o
+// .crim2s (texto, por defecto).
+// Si tempoMap no es nulo, se rellena con los cambios de tempo del archivo.
+// Los .mid y .crim2s pasan por la caché de canciones (ver songCache.h).
+std::vector<Track> loadSongFile(const std::string& filename, int& ticksPerBeat,
+                                std::vector<TempoEvent>* tempoMap = nullptr);
+
+// Indica si el nombre de archivo termina con la extensión dada (p. ej. ".crim2b")
+bool hasExtension(const std::string& filename, const std::string& extension);
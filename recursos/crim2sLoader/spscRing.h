@@ -0,0 +1,64 @@
+// spscRing.h
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+// Cola circular sin bloqueos para un solo productor y un solo consumidor. push y
+// pop terminan siempre en un número fijo de pasos (sin esperas ni mutex): si la
+// cola está llena, push devuelve false y el productor sigue su camino.
+template <typename T, std::size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity debe ser potencia de dos");
+    static_assert(std::is_trivially_copyable<T>::value, "Los registros deben ser copiables byte a byte");
+
+public:
+    // Solo desde el hilo productor
+    bool push(const T& value) {
+        std::size_t head = writeIndex.load(std::memory_order_relaxed);
+        if (head - cachedRead == Capacity) {
+            cachedRead = readIndex.load(std::memory_order_acquire);
+            if (head - cachedRead == Capacity) {
+                return false;
+            }
+        }
+        slots[head & (Capacity - 1)] = value;
+        writeIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Solo desde el hilo consumidor
+    bool pop(T& value) {
+        std::size_t tail = readIndex.load(std::memory_order_relaxed);
+        if (tail == cachedWrite) {
+            cachedWrite = writeIndex.load(std::memory_order_acquire);
+            if (tail == cachedWrite) {
+                return false;
+            }
+        }
+        value = slots[tail & (Capacity - 1)];
+        readIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Solo desde el hilo consumidor: llama f con todo lo pendiente y lo libera de una vez
+    template <typename F>
+    std::size_t drain(F f) {
+        std::size_t tail = readIndex.load(std::memory_order_relaxed);
+        std::size_t head = writeIndex.load(std::memory_order_acquire);
+        for (std::size_t i = tail; i != head; ++i) {
+            f(slots[i & (Capacity - 1)]);
+        }
+        readIndex.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+private:
+    // Cada índice en su propia línea de caché para que los hilos no se pisen
+    alignas(64) std::atomic<std::size_t> writeIndex{0};
+    std::size_t cachedRead = 0;  // Copia del productor de readIndex
+    alignas(64) std::atomic<std::size_t> readIndex{0};
+    std::size_t cachedWrite = 0; // Copia del consumidor de writeIndex
+    alignas(64) T slots[Capacity];
+};
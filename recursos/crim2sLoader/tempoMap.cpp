@@ -0,0 +1,54 @@
+// tempoMap.cpp
+
+#include "tempoMap.h"
+#include <algorithm>
+
+int bpmToMicrosecondsPerBeat(float bpm) {
+    if (bpm <= 0.0f) {
+        return DEFAULT_MICROSECONDS_PER_BEAT;
+    }
+    return static_cast<int>(60000000.0f / bpm + 0.5f);
+}
+
+TempoMap::TempoMap(int ticksPerBeat, int microsecondsPerBeat)
+    : ticks(ticksPerBeat > 0 ? ticksPerBeat : 480) {
+    segments.push_back({0, 0, microsecondsPerBeat > 0 ? microsecondsPerBeat : DEFAULT_MICROSECONDS_PER_BEAT});
+}
+
+TempoMap::TempoMap(int ticksPerBeat, const std::vector<TempoEvent>& events, int microsecondsPerBeat)
+    : TempoMap(ticksPerBeat, microsecondsPerBeat) {
+    segments.reserve(events.size() + 1);
+    for (const TempoEvent& event : events) {
+        append(event.tick, event.microsecondsPerBeat);
+    }
+}
+
+void TempoMap::append(int tick, int microsecondsPerBeat) {
+    if (microsecondsPerBeat <= 0) {
+        return;
+    }
+    Segment& last = segments.back();
+    std::int64_t start = std::max<std::int64_t>(tick, last.tick);
+    if (start == last.tick) {
+        // Varios set_tempo en el mismo tick: vale el último
+        last.microsecondsPerBeat = microsecondsPerBeat;
+        return;
+    }
+    segments.push_back({start, tickToMicros(start), microsecondsPerBeat});
+}
+
+std::int64_t TempoMap::tickToMicros(std::int64_t tick) const {
+    // Último tramo que empieza en o antes de tick
+    auto it = std::upper_bound(segments.begin(), segments.end(), tick,
+                               [](std::int64_t value, const Segment& s) { return value < s.tick; });
+    const Segment& s = it == segments.begin() ? segments.front() : *(it - 1);
+    // Redondeo hacia arriba: microsToTick(tickToMicros(t)) == t, así una nota nunca se adelanta
+    return s.micros + ((tick - s.tick) * s.microsecondsPerBeat + ticks - 1) / ticks;
+}
+
+std::int64_t TempoMap::microsToTick(std::int64_t micros) const {
+    auto it = std::upper_bound(segments.begin(), segments.end(), micros,
+                               [](std::int64_t value, const Segment& s) { return value < s.micros; });
+    const Segment& s = it == segments.begin() ? segments.front() : *(it - 1);
+    return s.tick + (micros - s.micros) * ticks / s.microsecondsPerBeat;
+}
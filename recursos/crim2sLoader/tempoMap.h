@@ -0,0 +1,43 @@
+// tempoMap.h
+
+#pragma once
+#include "crim2sLoader.h"
+#include <cstdint>
+#include <vector>
+
+// Tempo por defecto de MIDI (120 BPM) cuando el archivo no trae set_tempo
+const int DEFAULT_MICROSECONDS_PER_BEAT = 500000;
+
+// Convierte BPM a microsegundos por pulso (formato de set_tempo)
+int bpmToMicrosecondsPerBeat(float bpm);
+
+// Conversión entre ticks y microsegundos con cambios de tempo. Guarda, por cada
+// tramo de tempo constante, el tick inicial y los microsegundos acumulados hasta
+// él, así que convertir es una búsqueda binaria y una multiplicación entera.
+class TempoMap {
+public:
+    // Tempo constante (el de la línea de comandos si el archivo no trae tempo)
+    explicit TempoMap(int ticksPerBeat, int microsecondsPerBeat = DEFAULT_MICROSECONDS_PER_BEAT);
+
+    // Tempo inicial microsecondsPerBeat hasta el primer set_tempo de events
+    TempoMap(int ticksPerBeat, const std::vector<TempoEvent>& events,
+             int microsecondsPerBeat = DEFAULT_MICROSECONDS_PER_BEAT);
+
+    // Añade un cambio de tempo; los ticks deben llegar en orden (lectura en streaming)
+    void append(int tick, int microsecondsPerBeat);
+
+    std::int64_t tickToMicros(std::int64_t tick) const;
+    std::int64_t microsToTick(std::int64_t micros) const;
+
+    int ticksPerBeat() const { return ticks; }
+
+private:
+    struct Segment {
+        std::int64_t tick;
+        std::int64_t micros; // Microsegundos acumulados hasta tick
+        std::int64_t microsecondsPerBeat;
+    };
+
+    int ticks;
+    std::vector<Segment> segments;
+};
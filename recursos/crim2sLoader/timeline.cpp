@@ -0,0 +1,111 @@
+// timeline.cpp
+
+#include "timeline.h"
+#include <algorithm>
+#include <queue>
+#include <tuple>
+
+namespace {
+
+// Notas de una pista ordenadas por inicio (note_on) o por final (note_off)
+struct EventSource {
+    const std::vector<NoteEvent>* notes;
+    std::vector<std::size_t> order;
+    std::size_t next;
+    int track;
+    bool noteOn;
+
+    int tick() const {
+        const NoteEvent& note = (*notes)[order[next]];
+        return noteOn ? note.startTime : note.endTime;
+    }
+
+    // Orden dentro de un mismo tick: note_off, note_on y al final los note_off de
+    // notas de duración cero, que no pueden adelantarse a su propio note_on
+    int phase() const {
+        const NoteEvent& note = (*notes)[order[next]];
+        return noteOn ? 1 : (note.endTime == note.startTime ? 2 : 0);
+    }
+};
+
+EventSource makeSource(const std::vector<NoteEvent>& notes, int track, bool noteOn) {
+    EventSource source{&notes, std::vector<std::size_t>(notes.size()), 0, track, noteOn};
+    for (std::size_t i = 0; i < notes.size(); ++i) {
+        source.order[i] = i;
+    }
+    auto byTick = [&](std::size_t a, std::size_t b) {
+        if (noteOn) {
+            return notes[a].startTime < notes[b].startTime;
+        }
+        bool zeroA = notes[a].endTime == notes[a].startTime;
+        bool zeroB = notes[b].endTime == notes[b].startTime;
+        return notes[a].endTime < notes[b].endTime || (notes[a].endTime == notes[b].endTime && !zeroA && zeroB);
+    };
+    // Las pistas leídas ya vienen ordenadas por inicio; solo se ordena si no lo están
+    if (!std::is_sorted(source.order.begin(), source.order.end(), byTick)) {
+        std::stable_sort(source.order.begin(), source.order.end(), byTick);
+    }
+    return source;
+}
+
+} // namespace
+
+Timeline::Timeline(const std::vector<Track>& tracks) {
+    // Dos fuentes ordenadas por pista: sus note_on y sus note_off
+    std::vector<EventSource> sources;
+    std::size_t total = 0;
+    for (std::size_t t = 0; t < tracks.size(); ++t) {
+        const std::vector<NoteEvent>& notes = tracks[t].notes;
+        if (notes.empty()) continue;
+        sources.push_back(makeSource(notes, static_cast<int>(t), false));
+        sources.push_back(makeSource(notes, static_cast<int>(t), true));
+        total += 2 * notes.size();
+    }
+    events.reserve(total);
+
+    // Mezcla de k vías: (tick, fase, fuente)
+    typedef std::tuple<int, int, std::size_t> Head;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    for (std::size_t s = 0; s < sources.size(); ++s) {
+        heads.emplace(sources[s].tick(), sources[s].phase(), s);
+    }
+    // Notas de todas las pistas como intervalos, para saber qué suena en cualquier tick
+    std::vector<Interval> spans;
+    noteOns.reserve(total / 2);
+    spans.reserve(total / 2);
+    for (std::size_t t = 0; t < tracks.size(); ++t) {
+        for (const NoteEvent& note : tracks[t].notes) {
+            noteOns.push_back({note.startTime, static_cast<int>(t), static_cast<std::uint8_t>(note.channel),
+                               static_cast<std::uint8_t>(note.note), static_cast<std::uint8_t>(note.velocity), true});
+            spans.push_back({note.startTime, note.endTime});
+        }
+    }
+    sounding.build(spans);
+
+    while (!heads.empty()) {
+        std::size_t s = std::get<2>(heads.top());
+        heads.pop();
+        EventSource& source = sources[s];
+        const NoteEvent& note = (*source.notes)[source.order[source.next]];
+        events.push_back({source.tick(), source.track, static_cast<std::uint8_t>(note.channel),
+                          static_cast<std::uint8_t>(note.note), static_cast<std::uint8_t>(note.velocity),
+                          source.noteOn});
+        if (++source.next < source.order.size()) {
+            heads.emplace(source.tick(), source.phase(), s);
+        }
+    }
+}
+
+std::size_t Timeline::positionAfter(std::int64_t now) const {
+    auto after = std::upper_bound(events.begin(), events.end(), now,
+                                  [](std::int64_t tick, const TimelineEvent& event) { return tick < event.tick; });
+    return static_cast<std::size_t>(after - events.begin());
+}
+
+void Timeline::soundingAt(std::int64_t tick, std::vector<TimelineEvent>& out) const {
+    std::vector<std::size_t> found;
+    sounding.stab(tick, found);
+    for (std::size_t i : found) {
+        out.push_back(noteOns[i]);
+    }
+}
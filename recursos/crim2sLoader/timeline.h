@@ -0,0 +1,60 @@
+// timeline.h
+
+#pragma once
+#include "crim2sLoader.h"
+#include "intervalIndex.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Un note_on o note_off de la línea de tiempo de la canción
+struct TimelineEvent {
+    int tick;
+    int track;
+    std::uint8_t channel;
+    std::uint8_t note;
+    std::uint8_t velocity;
+    bool noteOn;
+};
+
+// Todos los note_on/note_off de todas las pistas en un único arreglo ordenado por
+// tick, construido al cargar mezclando las pistas (k vías). La reproducción es un
+// índice que solo avanza sobre memoria contigua.
+class Timeline {
+public:
+    Timeline() = default;
+    explicit Timeline(const std::vector<Track>& tracks);
+
+    // Llama fire(evento) para cada evento con tick <= now desde la última llamada.
+    // A igual tick, los note_off van antes que los note_on (salvo los de notas de duración cero).
+    template <typename Fire>
+    void advance(std::int64_t now, Fire fire) {
+        while (cursor < events.size() && events[cursor].tick <= now) {
+            fire(events[cursor++]);
+        }
+    }
+
+    // Sitúa el cursor tras los eventos con tick <= now, sin dispararlos
+    void seek(std::int64_t now) { cursor = positionAfter(now); }
+
+    // Posición del primer evento con tick > now (para precalcular saltos)
+    std::size_t positionAfter(std::int64_t now) const;
+    void setPosition(std::size_t position) { cursor = position; }
+
+    // Añade a out el note_on de cada nota que suena en el tick dado (start <= tick < end)
+    void soundingAt(std::int64_t tick, std::vector<TimelineEvent>& out) const;
+
+    void rewind() { cursor = 0; }
+    bool finished() const { return cursor == events.size(); }
+    std::size_t position() const { return cursor; }
+    std::size_t size() const { return events.size(); }
+    const TimelineEvent& operator[](std::size_t i) const { return events[i]; }
+
+private:
+    std::vector<TimelineEvent> events;
+    std::size_t cursor = 0;
+
+    // Para saltar: el note_on de cada nota y el índice de sus intervalos [inicio, final)
+    std::vector<TimelineEvent> noteOns;
+    IntervalIndex sounding;
+};
@@ -0,0 +1,59 @@
+// timelineTest.cpp
+// Comprobaciones de la línea de tiempo: ./timelineTest (o make test)
+
+#include "crim2sLoader.h"
+#include "timeline.h"
+#include <iostream>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::cerr << "FALLO: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// Una nota sin note_off que empieza después del último note_off leído: finish()
+// no puede cerrarla antes de su note_on, o la línea de tiempo la dejaría sonando
+void unclosedNoteAfterLastNoteOff() {
+    std::vector<Track> tracks(2);
+    NotePairer pairer(tracks, NoteOffPairing::FIFO);
+    pairer.noteOn(0, 0, 60, 64, 0);
+    pairer.noteOff(0, 0, 60, 100);
+    pairer.noteOn(1, 1, 64, 64, 200); // Sin note_off
+    pairer.finish();
+
+    check(tracks[1].notes[0].endTime >= tracks[1].notes[0].startTime, "endTime anterior al inicio de la nota");
+
+    Timeline timeline(tracks);
+    check(timeline.size() == 4, "la línea de tiempo debe tener 4 eventos");
+    int on = -1;
+    int off = -1;
+    for (std::size_t i = 0; i < timeline.size(); ++i) {
+        const TimelineEvent& event = timeline[i];
+        if (event.track == 1) {
+            (event.noteOn ? on : off) = static_cast<int>(i);
+        }
+    }
+    check(on >= 0 && off > on, "el note_off de la nota sin cerrar va antes que su note_on");
+
+    // Tras el último evento no queda nada sonando
+    std::vector<TimelineEvent> sounding;
+    timeline.soundingAt(timeline[timeline.size() - 1].tick + 1, sounding);
+    check(sounding.empty(), "queda una nota sonando al final");
+}
+
+} // namespace
+
+int main() {
+    unclosedNoteAfterLastNoteOff();
+    if (failures > 0) {
+        return 1;
+    }
+    std::cout << "timelineTest: OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,131 @@
+// trackFilter.cpp
+
+#include "trackFilter.h"
+#include <iostream>
+
+namespace {
+
+void flipTrack(TrackMask& mask, int track) {
+    mask.tracks[track >> 6] ^= 1ull << (track & 63);
+}
+
+bool anyTrack(const TrackMask& mask) {
+    for (std::uint64_t word : mask.tracks) {
+        if (word != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool anyBit(const TrackMask& mask) {
+    return anyTrack(mask) || mask.channels != 0;
+}
+
+// " pistas 1 3 canales 9": los índices con el bit a 1
+void printMask(std::ostream& out, const TrackMask& mask) {
+    if (anyTrack(mask)) {
+        out << " pistas";
+        for (int track = 0; track < TrackMask::MAX_TRACKS; ++track) {
+            if ((mask.tracks[track >> 6] >> (track & 63)) & 1) {
+                out << ' ' << track;
+            }
+        }
+    }
+    if (mask.channels != 0) {
+        out << " canales";
+        for (int channel = 0; channel < 16; ++channel) {
+            if ((mask.channels >> channel) & 1) {
+                out << ' ' << channel;
+            }
+        }
+    }
+}
+
+} // namespace
+
+void TrackFilter::toggleTrackMute(int track) {
+    if (track < 0 || track >= TrackMask::MAX_TRACKS) {
+        std::cerr << "Error: solo se pueden silenciar las pistas 0 a " << TrackMask::MAX_TRACKS - 1 << std::endl;
+        return;
+    }
+    flipTrack(muted, track);
+    update();
+}
+
+void TrackFilter::toggleTrackSolo(int track) {
+    if (track < 0 || track >= TrackMask::MAX_TRACKS) {
+        std::cerr << "Error: solo se pueden aislar las pistas 0 a " << TrackMask::MAX_TRACKS - 1 << std::endl;
+        return;
+    }
+    flipTrack(soloed, track);
+    update();
+}
+
+void TrackFilter::toggleChannelMute(int channel) {
+    muted.channels ^= 1u << (channel & 0x0F);
+    update();
+}
+
+void TrackFilter::toggleChannelSolo(int channel) {
+    soloed.channels ^= 1u << (channel & 0x0F);
+    update();
+}
+
+void TrackFilter::toggle(int index, bool solo, bool channel) {
+    if (channel) {
+        solo ? toggleChannelSolo(index) : toggleChannelMute(index);
+    } else {
+        solo ? toggleTrackSolo(index) : toggleTrackMute(index);
+    }
+}
+
+TrackMask TrackFilter::mask() const {
+    TrackMask mask;
+    std::uint64_t before;
+    std::uint64_t after;
+    do {
+        before = sequence.load(std::memory_order_acquire);
+        for (int word = 0; word < TrackMask::MAX_TRACKS / 64; ++word) {
+            mask.tracks[word] = publishedTracks[word].load(std::memory_order_relaxed);
+        }
+        mask.channels = publishedChannels.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence.load(std::memory_order_relaxed);
+    } while (before != after || (before & 1) != 0);
+    return mask;
+}
+
+void TrackFilter::publish() {
+    std::uint64_t version = sequence.load(std::memory_order_relaxed);
+    sequence.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int word = 0; word < TrackMask::MAX_TRACKS / 64; ++word) {
+        publishedTracks[word].store(current.tracks[word], std::memory_order_relaxed);
+    }
+    publishedChannels.store(current.channels, std::memory_order_relaxed);
+    sequence.store(version + 2, std::memory_order_release);
+}
+
+void TrackFilter::update() {
+    TrackMask next;
+    bool trackSolo = anyTrack(soloed);
+    for (int word = 0; word < TrackMask::MAX_TRACKS / 64; ++word) {
+        next.tracks[word] = trackSolo ? soloed.tracks[word] : ~muted.tracks[word];
+    }
+    next.channels = (soloed.channels != 0 ? soloed.channels : ~muted.channels) & 0xFFFF;
+    current = next;
+    publish();
+
+    if (!anyBit(muted) && !anyBit(soloed)) {
+        std::cout << "Suenan todas las pistas y canales" << std::endl;
+        return;
+    }
+    if (anyBit(muted)) {
+        printMask(std::cout << "Silencio:", muted);
+    }
+    if (anyBit(soloed)) {
+        printMask(std::cout << (anyBit(muted) ? " | Solo:" : "Solo:"), soloed);
+    }
+    std::cout << std::endl;
+}
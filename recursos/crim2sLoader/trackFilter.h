@@ -0,0 +1,60 @@
+// trackFilter.h
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Pistas y canales que suenan, un bit por cada uno. Comprobar un evento es un
+// desplazamiento y un AND; las pistas fuera de rango suenan siempre.
+struct TrackMask {
+    static const int MAX_TRACKS = 256;
+
+    std::uint64_t tracks[MAX_TRACKS / 64] = {~0ull, ~0ull, ~0ull, ~0ull};
+    std::uint32_t channels = 0xFFFF;
+
+    bool trackAudible(int track) const {
+        return track < 0 || track >= MAX_TRACKS || ((tracks[track >> 6] >> (track & 63)) & 1);
+    }
+    bool audible(int track, int channel) const {
+        return trackAudible(track) && ((channels >> (channel & 0x0F)) & 1);
+    }
+};
+
+// Silencio y solo de pistas y canales en vivo. Los cambios llegan desde el hilo
+// principal (teclado); el hilo de envío guarda su propia copia de la máscara y
+// solo la vuelve a pedir cuando cambia version(). La máscara se publica con una
+// secuencia de versiones (como PlaybackClock): leerla nunca bloquea al hilo de envío.
+class TrackFilter {
+public:
+    // Desde el hilo principal
+    void toggleTrackMute(int track);
+    void toggleTrackSolo(int track);
+    void toggleChannelMute(int channel);
+    void toggleChannelSolo(int channel);
+
+    // Teclas de función: index es la pista (o el canal, con channel) desde 0
+    void toggle(int index, bool solo, bool channel);
+
+    // Para el dibujo, desde el hilo principal
+    bool trackAudible(int track) const { return current.trackAudible(track); }
+    bool audible(int track, int channel) const { return current.audible(track, channel); }
+
+    // Desde cualquier hilo, sin bloquear
+    std::uint64_t version() const { return sequence.load(std::memory_order_acquire); }
+    TrackMask mask() const;
+
+private:
+    // Recalcula la máscara: con algún solo suenan solo esos, si no todo menos lo silenciado
+    void update();
+
+    // Publica current para mask(); número impar de sequence mientras se escribe
+    void publish();
+
+    TrackMask muted{{0, 0, 0, 0}, 0};
+    TrackMask soloed{{0, 0, 0, 0}, 0};
+    TrackMask current; // Copia del hilo principal
+
+    std::atomic<std::uint64_t> sequence{0};
+    std::atomic<std::uint64_t> publishedTracks[TrackMask::MAX_TRACKS / 64] = {{~0ull}, {~0ull}, {~0ull}, {~0ull}};
+    std::atomic<std::uint32_t> publishedChannels{0xFFFF};
+};
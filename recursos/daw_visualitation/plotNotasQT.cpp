@@ -1,25 +1,31 @@
 #include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <cmath>
-#include <mutex>
 #include <rtmidi/RtMidi.h>
+#include "../crim2sLoader/songFile.h"
+#include "../crim2sLoader/commandLine.h"
+#include "../crim2sLoader/headlessPlayback.h"
+#include "../crim2sLoader/loopRegion.h"
+#include "../crim2sLoader/midiDispatcher.h"
+#include "../crim2sLoader/midiRouter.h"
+#include "../crim2sLoader/playbackControls.h"
+#include "../crim2sLoader/rtMidiSink.h"
+#include "../crim2sLoader/tempoMap.h"
+#include "../crim2sLoader/trackFilter.h"
 
-struct NoteEvent {
-    int note;
-    int startTime;
-    int endTime;
-    bool noteOnSent = false;
-    bool noteOffSent = false;
-};
-
-struct Track {
-    std::vector<NoteEvent> notes;
-};
-
-std::mutex noteMutex;
+// Zoom horizontal (Re Pág/Av Pág): factor de cada pulsación y límites en píxeles por segundo
+const float ZOOM_STEP = 1.25f;
+const float MIN_PIXELS_PER_SECOND = 25.0f;
+const float MAX_PIXELS_PER_SECOND = 400.0f;
 
 sf::Color setColorByOctaveLinealAbss2(int note) {
     float colors[12][3] = {
@@ -31,149 +37,354 @@ sf::Color setColorByOctaveLinealAbss2(int note) {
     return sf::Color(colors[note % 12][0], colors[note % 12][1], colors[note % 12][2]);
 }
 
-std::vector<Track> readCrim2sFile(const std::string& filename, int& ticksPerBeat) {
-    std::ifstream file(filename);
-    std::vector<Track> tracks;
-    if (!file.is_open()) {
-        std::cerr << "Error al abrir el archivo " << filename << std::endl;
-        return tracks;
-    }
-    std::string line;
-    int totalTracks = 0;
-    // Leer información del encabezado
-    while (std::getline(file, line)) {
-        if (line.find("Ticks per beat:") != std::string::npos) {
-            sscanf(line.c_str(), "Ticks per beat: %d", &ticksPerBeat);
-        } else if (line.find("Número de pistas:") != std::string::npos) {
-            sscanf(line.c_str(), "Número de pistas: %d", &totalTracks);
-            tracks.resize(totalTracks);
-        } else if (line.find("Eventos:") != std::string::npos) {
-            break;
-        }
-    }
-
-    // Leer los eventos
-    while (std::getline(file, line)) {
-        int time = 0, trackIndex = 0;
-        char msgType[16];
-        int channel = 0, note = 0, velocity = 0;
-        if (sscanf(line.c_str(), "Time=%d Track=%d %s", &time, &trackIndex, msgType) >= 3) {
-            if (std::string(msgType) == "note_on" || std::string(msgType) == "note_off") {
-                if (sscanf(line.c_str(), "Time=%d Track=%d %s channel=%d note=%d velocity=%d", &time, &trackIndex, msgType, &channel, &note, &velocity) == 6) {
-                    if (trackIndex >= totalTracks) {
-                        std::cerr << "Índice de pista inválido " << trackIndex << std::endl;
-                        continue;
-                    }
-                    if (std::string(msgType) == "note_on" && velocity > 0) {
-                        NoteEvent newNote;
-                        newNote.note = note;
-                        newNote.startTime = time;
-                        newNote.endTime = -1;
-                        tracks[trackIndex].notes.push_back(newNote);
-                    } else {
-                        // Encontrar la nota y establecer endTime
-                        for (auto& n : tracks[trackIndex].notes) {
-                            if (n.note == note && n.endTime == -1) {
-                                n.endTime = time;
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
+// Nota del piano roll con sus tiempos ya convertidos a microsegundos
+struct RollNote {
+    std::int64_t startMicros;
+    std::int64_t endMicros;
+    int note;
+    int channel;
+};
 
-    // Establecer endTime para notas que no lo tienen
-    int maxTime = 0;
-    for (const auto& track : tracks) {
-        for (const auto& note : track.notes) {
-            if (note.endTime > maxTime) {
-                maxTime = note.endTime;
-            }
-        }
+// Notas de una pista ordenadas por inicio, con el mayor final hasta cada una
+// (maxEndMicros[i] = máximo de endMicros en [0, i], creciente). Las que se ven en
+// una ventana [from, to) salen de dos búsquedas binarias: desde la primera cuyo
+// maxEnd llega a from hasta la última que empieza antes de to.
+struct RollTrack {
+    std::vector<RollNote> notes;
+    std::vector<std::int64_t> maxEndMicros;
+};
+
+// Margen de las búsquedas: la prueba exacta en píxeles decide en los bordes
+const std::int64_t CULL_MARGIN_MICROS = 1000;
+
+RollTrack buildRollTrack(const Track& track, const TempoMap& tempoMap) {
+    RollTrack roll;
+    roll.notes.reserve(track.notes.size());
+    for (const NoteEvent& note : track.notes) {
+        roll.notes.push_back({tempoMap.tickToMicros(note.startTime), tempoMap.tickToMicros(note.endTime), note.note, note.channel});
     }
-    for (auto& track : tracks) {
-        for (auto& note : track.notes) {
-            if (note.endTime == -1) {
-                note.endTime = maxTime;
-            }
-        }
+    std::stable_sort(roll.notes.begin(), roll.notes.end(), [](const RollNote& a, const RollNote& b) {
+        return a.startMicros < b.startMicros;
+    });
+    roll.maxEndMicros.reserve(roll.notes.size());
+    std::int64_t maxEnd = INT64_MIN;
+    for (const RollNote& note : roll.notes) {
+        maxEnd = std::max(maxEnd, note.endMicros);
+        roll.maxEndMicros.push_back(maxEnd);
     }
-
-    file.close();
-    return tracks;
+    return roll;
 }
 
-void processTrack(Track& track, float visualScrollSpeed, int trackIndex, float trackHeight, float noteHeight, float currentTimeSeconds, float activationLineX, std::vector<sf::RectangleShape>& noteShapes, RtMidiOut &midiout, float pixelsPerSecond, float ticksPerSecond) {
+// Añade a quads las notas de la pista que caen entre leftX y rightX, cuatro
+// vértices por nota; originX es donde se pinta el instante originMicros. El arreglo
+// se reutiliza en cada fotograma (clear() conserva su memoria), así que ni se
+// reserva memoria ni se crea una forma por nota, y se dibuja de una vez. Solo se
+// recorren las notas de la ventana visible, no toda la canción. Las notas de los
+// canales silenciados en mask no se pintan.
+void processTrack(const RollTrack& roll, int trackIndex, float trackHeight, float noteHeight, std::int64_t originMicros, float originX, float leftX, float rightX, float pixelsPerSecond, const TrackMask& mask, sf::VertexArray& quads) {
     float yOffset = trackIndex * trackHeight;
 
-    for (auto& note : track.notes) {
-        float noteStartTimeSeconds = note.startTime / ticksPerSecond;
-        float noteEndTimeSeconds = note.endTime / ticksPerSecond;
+    // Visibles: terminan a la derecha de leftX y empiezan a la izquierda de rightX
+    std::int64_t from = originMicros + static_cast<std::int64_t>((leftX - originX) / pixelsPerSecond * 1000000.0f) - CULL_MARGIN_MICROS;
+    std::int64_t to = originMicros + static_cast<std::int64_t>((rightX - originX) / pixelsPerSecond * 1000000.0f) + CULL_MARGIN_MICROS;
+    std::size_t first = std::lower_bound(roll.maxEndMicros.begin(), roll.maxEndMicros.end(), from) - roll.maxEndMicros.begin();
+    std::size_t last = std::lower_bound(roll.notes.begin() + first, roll.notes.end(), to, [](const RollNote& note, std::int64_t micros) {
+        return note.startMicros < micros;
+    }) - roll.notes.begin();
+
+    for (std::size_t i = first; i < last; ++i) {
+        const RollNote& note = roll.notes[i];
+        if (!mask.audible(trackIndex, note.channel)) {
+            continue;
+        }
 
         // Calcula la posición horizontal de la nota en la pantalla
-        float xPosition = 800 - pixelsPerSecond * (currentTimeSeconds - noteStartTimeSeconds);
-        float durationSeconds = noteEndTimeSeconds - noteStartTimeSeconds;
-        float noteWidth = durationSeconds * pixelsPerSecond;
+        float xPosition = originX + pixelsPerSecond * (note.startMicros - originMicros) / 1000000.0f;
+        float noteWidth = pixelsPerSecond * (note.endMicros - note.startMicros) / 1000000.0f;
 
         // Genera la visualización de la nota en pantalla
-        if (xPosition + noteWidth >= activationLineX && xPosition < 800) {
-            sf::RectangleShape rect(sf::Vector2f(noteWidth, noteHeight - 5));
-            rect.setFillColor(setColorByOctaveLinealAbss2(note.note));
+        if (xPosition + noteWidth >= leftX && xPosition < rightX) {
+            sf::Color color = setColorByOctaveLinealAbss2(note.note);
             int noteIndex = note.note % 12;
             float yPosition = yOffset + noteIndex * noteHeight;
-            rect.setPosition(xPosition, yPosition);
+            float bottom = yPosition + noteHeight - 5;
+            quads.append(sf::Vertex(sf::Vector2f(xPosition, yPosition), color));
+            quads.append(sf::Vertex(sf::Vector2f(xPosition + noteWidth, yPosition), color));
+            quads.append(sf::Vertex(sf::Vector2f(xPosition + noteWidth, bottom), color));
+            quads.append(sf::Vertex(sf::Vector2f(xPosition, bottom), color));
+        }
+    }
+}
+
+// Piano roll prerrenderizado en baldosas de TILE_WIDTH píxeles. Solo viven
+// TILE_COUNT texturas: las de pantalla y las que vienen, que un hilo aparte dibuja
+// por delante de la reproducción y reutiliza al avanzar, así que la memoria no
+// depende de la duración de la canción. Cada fotograma solo pega las dos o tres
+// baldosas que caen en pantalla, sea cual sea la densidad de notas. Al cambiar el
+// zoom o lo que suena se redibujan las mismas texturas; mientras falte alguna de
+// las visibles, draw() devuelve false y se dibuja nota a nota.
+class RollTiles {
+public:
+    static const int TILE_WIDTH = 1024;
+    static const int TILE_HEIGHT = 600;
+    static const int TILE_COUNT = 6; // Unos 15 MB de textura en total
 
-            // Bloquea el mutex para evitar conflictos al agregar una nueva forma
-            std::lock_guard<std::mutex> lock(noteMutex);
-            noteShapes.push_back(rect);
+    RollTiles(const std::vector<RollTrack>& rolls, float trackHeight, float noteHeight)
+        : rolls(rolls), trackHeight(trackHeight), noteHeight(noteHeight), slots(TILE_COUNT) {
+        for (const RollTrack& roll : rolls) {
+            if (!roll.maxEndMicros.empty()) {
+                songEndMicros = std::max(songEndMicros, roll.maxEndMicros.back());
+            }
         }
+        builder = std::thread(&RollTiles::work, this);
+    }
 
-        // Enviar note_on cuando la nota cruce la línea de activación
-        if (!note.noteOnSent && xPosition <= activationLineX) {
-            std::vector<unsigned char> message = {0x90, static_cast<unsigned char>(note.note), 64};
-            midiout.sendMessage(&message);
-            note.noteOnSent = true;
+    ~RollTiles() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
         }
+        wake.notify_one();
+        builder.join();
+    }
 
-        // Enviar note_off cuando termine la duración de la nota
-        if (!note.noteOffSent && xPosition + noteWidth <= activationLineX) {
-            std::vector<unsigned char> message = {0x80, static_cast<unsigned char>(note.note), 64};
-            midiout.sendMessage(&message);
-            note.noteOffSent = true;
+    // Se llama en cada fotograma con el zoom, el filtro y el instante en la línea de
+    // activación: si algo cambia, el hilo rehace las baldosas que faltan
+    void request(float pixelsPerSecond, const TrackFilter& filter, std::int64_t lineMicros) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bool changed = false;
+        if (pixelsPerSecond != wantedPixelsPerSecond || filter.version() != wantedFilterVersion) {
+            wantedPixelsPerSecond = pixelsPerSecond;
+            wantedFilterVersion = filter.version();
+            wantedMask = filter.mask();
+            ++generation;
+            failed = false;
+            changed = true;
+        }
+        long first = firstTile(lineMicros);
+        if (first != wantedFirst) {
+            wantedFirst = first;
+            changed = true;
+        }
+        if (changed) {
+            wake.notify_one();
+        }
+    }
+
+    // Pega las baldosas entre la línea de activación y el borde derecho;
+    // lineMicros es el instante que está en la línea
+    bool draw(sf::RenderTarget& target, std::int64_t lineMicros, float activationLineX, float pixelsPerSecond) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (failed || pixelsPerSecond != wantedPixelsPerSecond) {
+            return false;
+        }
+        double linePixels = pixelsPerSecond * static_cast<double>(lineMicros) / 1000000.0;
+        long first = firstTile(lineMicros);
+
+        // Primero comprobar que están todas: o se pega todo o nada
+        const Slot* visible[TILE_COUNT] = {};
+        int count = 0;
+        for (long k = first; k < tileCount() && count < TILE_COUNT; ++k) {
+            float tileLeft = static_cast<float>(std::round(activationLineX + k * TILE_WIDTH - linePixels));
+            if (tileLeft >= 800) {
+                break;
+            }
+            visible[count] = find(k);
+            if (visible[count] == nullptr) {
+                return false;
+            }
+            ++count;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            long k = visible[i]->index;
+            float tileLeft = static_cast<float>(std::round(activationLineX + k * TILE_WIDTH - linePixels));
+            // A la izquierda de la línea no se pinta nada: lo que ya pasó
+            float left = std::max(tileLeft, activationLineX);
+            float right = std::min(tileLeft + TILE_WIDTH, 800.0f);
+            if (right <= left) {
+                continue;
+            }
+            sf::Sprite sprite(visible[i]->texture->getTexture(), sf::IntRect(static_cast<int>(left - tileLeft), 0, static_cast<int>(right - left), TILE_HEIGHT));
+            sprite.setPosition(left, 0);
+            target.draw(sprite);
+        }
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::unique_ptr<sf::RenderTexture> texture;
+        long index = -1;              // Baldosa que contiene (-1: ninguna)
+        std::uint64_t generation = 0; // Zoom y filtro con los que se dibujó
+        bool ready = false;
+    };
+
+    // Con el mutex tomado
+    std::int64_t tileMicros() const {
+        return static_cast<std::int64_t>(TILE_WIDTH / wantedPixelsPerSecond * 1000000.0f);
+    }
+    long tileCount() const { return static_cast<long>(songEndMicros / tileMicros() + 1); }
+    long firstTile(std::int64_t lineMicros) const {
+        return std::max(0L, static_cast<long>(std::floor(static_cast<double>(lineMicros) / tileMicros())));
+    }
+    const Slot* find(long index) const {
+        for (const Slot& slot : slots) {
+            if (slot.ready && slot.index == index && slot.generation == generation) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    // Hilo constructor: dibuja la baldosa que falte más cercana a la línea en una
+    // textura que ya no haga falta, y vuelve a esperar
+    void work() {
+        sf::VertexArray quads(sf::Quads);
+        while (true) {
+            long index = -1;
+            Slot* slot = nullptr;
+            float pixelsPerSecond = 0;
+            TrackMask mask;
+            std::int64_t originMicros = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] {
+                    if (stopping) {
+                        return true;
+                    }
+                    if (failed || wantedPixelsPerSecond <= 0) {
+                        return false;
+                    }
+                    for (long k = wantedFirst; k < wantedFirst + TILE_COUNT && k < tileCount(); ++k) {
+                        if (find(k) == nullptr) {
+                            index = k;
+                            return true;
+                        }
+                    }
+                    return false;
+                });
+                if (stopping) {
+                    return;
+                }
+                // Reutilizar una textura fuera de la ventana, de otro zoom o aún vacía
+                for (Slot& candidate : slots) {
+                    bool inWindow = candidate.index >= wantedFirst && candidate.index < wantedFirst + TILE_COUNT;
+                    if (!candidate.ready || candidate.generation != generation || !inWindow) {
+                        slot = &candidate;
+                        break;
+                    }
+                }
+                slot->ready = false;
+                slot->index = index;
+                slot->generation = generation;
+                pixelsPerSecond = wantedPixelsPerSecond;
+                mask = wantedMask;
+                originMicros = index * tileMicros();
+            }
+
+            if (!slot->texture) {
+                slot->texture.reset(new sf::RenderTexture());
+                if (!slot->texture->create(TILE_WIDTH, TILE_HEIGHT)) {
+                    // Sin baldosas para este zoom: se dibuja nota a nota hasta que cambie
+                    std::cerr << "Error: no se pudo crear una baldosa del piano roll" << std::endl;
+                    slot->texture.reset();
+                    std::lock_guard<std::mutex> lock(mutex);
+                    failed = true;
+                    continue;
+                }
+            }
+
+            // Las notas que cruzan el borde de una baldosa se pintan en las dos
+            quads.clear();
+            for (std::size_t i = 0; i < rolls.size(); ++i) {
+                if (mask.trackAudible(static_cast<int>(i))) {
+                    processTrack(rolls[i], static_cast<int>(i), trackHeight, noteHeight, originMicros, 0.0f, 0.0f, TILE_WIDTH, pixelsPerSecond, mask, quads);
+                }
+            }
+            slot->texture->clear(sf::Color(0, 0, 0, 0)); // Transparente: las líneas de pista se ven debajo
+            slot->texture->draw(quads);
+            slot->texture->display();
+            slot->texture->setActive(false); // Soltar el contexto para que el hilo principal vea la textura acabada
+
+            std::lock_guard<std::mutex> lock(mutex);
+            slot->ready = true;
         }
     }
-}
+
+    const std::vector<RollTrack>& rolls;
+    float trackHeight;
+    float noteHeight;
+    std::int64_t songEndMicros = 0;
+
+    // Protegido por mutex
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Slot> slots;
+    float wantedPixelsPerSecond = 0;
+    std::uint64_t wantedFilterVersion = 0;
+    TrackMask wantedMask;
+    std::uint64_t generation = 0;
+    long wantedFirst = 0;
+    bool failed = false; // No se pudo crear una textura con este zoom
+    bool stopping = false;
+
+    std::thread builder;
+};
 
 int main(int argc, char* argv[]) {
+    // --headless: sin ventana ni MIDI, reloj simulado lo más rápido posible
+    bool headless = takeFlag(argc, argv, "--headless");
+
+    // --loop A:B: repite sin fin los compases A a B (o los ticks At:Bt)
+    std::string loopText;
+    bool looping = takeOption(argc, argv, "--loop", loopText);
+
+    // --tiles: el piano roll se dibuja por adelantado en baldosas y cada fotograma solo las pega
+    bool tiled = takeFlag(argc, argv, "--tiles");
+
+    // --ports N, --virtual, --routes tabla: reparto de las pistas entre puertos MIDI
+    MidiOutputOptions midiOptions;
+    if (!takeMidiOutputOptions(argc, argv, midiOptions)) {
+        return -1;
+    }
+
     // Verifica que el usuario proporcione el archivo de entrada y los BPM como argumentos
     if (argc != 3) {
-        std::cerr << "Uso: " << argv[0] << " <ruta al archivo .crim2s> <bpm>" << std::endl;
+        printPlaybackUsage(argv[0], " [--tiles]",
+                           {"--tiles: prerrenderiza el piano roll en baldosas (coste por fotograma constante)"});
         return -1;
     }
     std::string crim2sFilePath = argv[1];
     float bpm = std::stof(argv[2]);
 
-    // Inicializa salida MIDI
-    RtMidiOut midiout;
-    unsigned int nPorts = midiout.getPortCount();
-    if (nPorts == 0) {
-        std::cout << "No ports available!\n";
+    // Sin ventana ni puertos MIDI: se mide antes de abrir nada
+    if (headless) {
+        return runHeadlessFile(crim2sFilePath, bpm);
+    }
+
+    // Abrir los puertos de salida MIDI
+    RtMidiPorts midiPorts;
+    if (!midiPorts.open(midiOptions.ports, midiOptions.virtualPorts)) {
         return -1;
     }
-    midiout.openPort(0);
 
     int ticksPerBeat = 480; // Valor por defecto, se actualizará al leer el archivo
-    std::vector<Track> tracks = readCrim2sFile(crim2sFilePath, ticksPerBeat);
+    std::vector<TempoEvent> tempoEvents;
+    std::vector<Track> tracks = loadSongFile(crim2sFilePath, ticksPerBeat, &tempoEvents);
     if (tracks.empty()) {
         std::cerr << "Error: no se encontraron pistas en el archivo." << std::endl;
         return -1;
     }
 
-    // Calcula ticks por segundo
-    float beatsPerSecond = bpm / 60.0f;
-    float ticksPerSecond = ticksPerBeat * beatsPerSecond;
+    // Mapa de tempo del archivo; los BPM indicados valen hasta el primer set_tempo
+    TempoMap tempoMap(ticksPerBeat, tempoEvents, bpmToMicrosecondsPerBeat(bpm));
+
+    // Bucle A/B opcional
+    LoopRegion loop;
+    if (looping && !parseLoopRegion(loopText, tempoMap, loop)) {
+        return -1;
+    }
 
     // Configura ventana de visualización
     sf::RenderWindow window(sf::VideoMode(800, 600), "MIDI Visualizer with Tracks");
@@ -184,9 +395,47 @@ int main(int argc, char* argv[]) {
     float noteHeight = trackHeight / 12.0f;
     float pixelsPerSecond = 100.0f; // Ajusta este valor para cambiar la escala horizontal
 
-    sf::Clock clock;
     float activationLineX = 200.0f;
-    std::vector<sf::RectangleShape> noteShapes;
+
+    // Notas de cada pista ordenadas por inicio, en microsegundos: el recorte busca en ellas
+    std::vector<RollTrack> rollTracks;
+    rollTracks.reserve(numTracks);
+    for (const Track& track : tracks) {
+        rollTracks.push_back(buildRollTrack(track, tempoMap));
+    }
+
+    // Un arreglo de quads persistente por pista: una llamada de dibujo por pista
+    std::vector<sf::VertexArray> trackQuads(numTracks, sf::VertexArray(sf::Quads));
+
+    // Con --tiles, baldosas prerrenderizadas en segundo plano, por delante de la reproducción
+    std::unique_ptr<RollTiles> rollTiles;
+    if (tiled) {
+        rollTiles.reset(new RollTiles(rollTracks, trackHeight, noteHeight));
+    }
+
+    // Lo que tarda una nota en llegar desde el borde derecho hasta la línea de activación
+    // con el zoom inicial. El zoom se ancla en la línea: las notas la cruzan siempre a
+    // la misma hora (la del envío MIDI) y lo que cambia es cuánto se ve por delante.
+    std::int64_t leadMicros = static_cast<std::int64_t>((800 - activationLineX) / pixelsPerSecond * 1000000.0f);
+
+    // Reloj de reproducción compartido por el envío MIDI y el dibujo
+    PlaybackClock playbackClock;
+
+    MidiRouter midiSink(midiPorts.sinks(), midiOptions.routing);
+
+    // Envío MIDI en su propio hilo, cuando cada nota cruza la línea de activación
+    MidiDispatcher dispatcher(Timeline(tracks), tempoMap, playbackClock, midiSink, leadMicros);
+
+    // Silencio y solo en vivo: lo silenciado (pista o canal) no se envía ni se dibuja
+    TrackFilter trackFilter;
+    dispatcher.setTrackFilter(trackFilter);
+    PlaybackControls controls(playbackClock, dispatcher, trackFilter);
+
+    dispatcher.setLoop(loop);
+
+    // Arranca el reloj de la canción y el envío MIDI
+    playbackClock.start();
+    dispatcher.start();
 
     // Bucle principal de la ventana
     while (window.isOpen()) {
@@ -194,10 +443,23 @@ int main(int argc, char* argv[]) {
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();
+            else if (event.type == sf::Event::KeyPressed) {
+                // El dibujo sale solo de la posición del reloj: tras un salto no hay nada que rehacer
+                controls.keyPressed(event.key);
+
+                // Zoom: Re Pág acerca, Av Pág aleja
+                if (event.key.code == sf::Keyboard::PageUp) {
+                    pixelsPerSecond = std::min(MAX_PIXELS_PER_SECOND, pixelsPerSecond * ZOOM_STEP);
+                } else if (event.key.code == sf::Keyboard::PageDown) {
+                    pixelsPerSecond = std::max(MIN_PIXELS_PER_SECOND, pixelsPerSecond / ZOOM_STEP);
+                }
+            }
         }
+        controls.apply();
 
-        sf::Time elapsed = clock.getElapsedTime();
-        float currentTimeSeconds = elapsed.asSeconds();
+        // Instante de la canción que está en la línea de activación (con bucle, el de esta vuelta)
+        std::int64_t lap = 0;
+        std::int64_t lineMicros = loop.wrap(playbackClock.micros() - leadMicros, lap);
 
         window.clear();
 
@@ -216,20 +478,31 @@ int main(int argc, char* argv[]) {
             window.draw(trackLine);
         }
 
-    // Procesa cada pista para visualización y reproducción
-        for (int i = 0; i < numTracks; ++i) {
-            processTrack(tracks[i], 0.0f, i, trackHeight, noteHeight, currentTimeSeconds, activationLineX, noteShapes, midiout, pixelsPerSecond, ticksPerSecond);
+        // Con baldosas listas para este zoom y este filtro basta con pegarlas
+        if (rollTiles) {
+            rollTiles->request(pixelsPerSecond, trackFilter, lineMicros);
         }
+        if (!rollTiles || !rollTiles->draw(window, lineMicros, activationLineX, pixelsPerSecond)) {
+            // Procesa cada pista para visualización (el MIDI lo envía el dispatcher); las
+            // silenciadas no se calculan
+            TrackMask drawMask = trackFilter.mask();
+            for (int i = 0; i < numTracks; ++i) {
+                trackQuads[i].clear();
+                if (trackFilter.trackAudible(i)) {
+                    processTrack(rollTracks[i], i, trackHeight, noteHeight, lineMicros, activationLineX, activationLineX, 800.0f, pixelsPerSecond, drawMask, trackQuads[i]);
+                }
+            }
 
-        // Dibuja las notas en pantalla
-        for (const auto& shape : noteShapes) {
-            if (shape.getPosition().x + shape.getSize().x > 0 && shape.getPosition().x < 800) {
-                window.draw(shape);
+            // Dibuja las notas en pantalla
+            for (const sf::VertexArray& quads : trackQuads) {
+                window.draw(quads);
             }
         }
-        noteShapes.clear(); // Limpia las formas de notas para la próxima iteración
-        window.display();   // Muestra el contenido en la ventana
+        window.display(); // Muestra el contenido en la ventana
     }
 
+    dispatcher.stop();
+    dispatcher.printSendStats(std::cout);
+    midiSink.printPortStats(std::cout);
     return 0;
 }
@@ -11,6 +11,17 @@
 #include <rtmidi/RtMidi.h>
 #include <algorithm>
 #include "../colorFunctions/colorFunctions.h"  // Asegúrate de que la ruta es correcta según tu estructura de carpetas
+#include "../crim2sLoader/songFile.h"
+#include "../crim2sLoader/commandLine.h"
+#include "../crim2sLoader/headlessPlayback.h"
+#include "../crim2sLoader/loopRegion.h"
+#include "../crim2sLoader/midiDispatcher.h"
+#include "../crim2sLoader/midiRouter.h"
+#include "../crim2sLoader/playbackControls.h"
+#include "../crim2sLoader/rtMidiSink.h"
+#include "../crim2sLoader/noteScheduler.h"
+#include "../crim2sLoader/tempoMap.h"
+#include "../crim2sLoader/trackFilter.h"
 
 // -------------------------- Constantes --------------------------
 const int WINDOW_WIDTH = 800;
@@ -27,20 +38,6 @@ const float SHAPE_INITIAL_SCALE = 0.1f; // Escala inicial
 
 // -------------------------- Estructuras --------------------------
 
-// Estructura para representar un evento de nota
-struct NoteEvent {
-    int note;
-    int startTime;
-    int endTime;
-    bool noteOnSent = false;
-    bool noteOffSent = false;
-};
-
-// Estructura para representar una pista
-struct Track {
-    std::vector<NoteEvent> notes;
-};
-
 // Enum para definir tipos de formas
 enum class ShapeType {
     Circle,       
@@ -171,79 +168,6 @@ struct NoteShape {
     }
 };
 
-// Lee el archivo .crim2s y devuelve las pistas
-std::vector<Track> readCrim2sFile(const std::string& filename, int& ticksPerBeat) {
-    std::ifstream file(filename);
-    std::vector<Track> tracks;
-    if (!file.is_open()) {
-        std::cerr << "Error al abrir el archivo " << filename << std::endl;
-        return tracks;
-    }
-    std::string line;
-    int totalTracks = 0;
-    while (std::getline(file, line)) {
-        if (line.find("Ticks per beat:") != std::string::npos) {
-            sscanf(line.c_str(), "Ticks per beat: %d", &ticksPerBeat);
-        } else if (line.find("Número de pistas:") != std::string::npos) {
-            sscanf(line.c_str(), "Número de pistas: %d", &totalTracks);
-            tracks.resize(totalTracks);
-        } else if (line.find("Eventos:") != std::string::npos) {
-            break;
-        }
-    }
-
-    while (std::getline(file, line)) {
-        int time = 0, trackIndex = 0;
-        char msgType[16];
-        int channel = 0, note = 0, velocity = 0;
-        if (sscanf(line.c_str(), "Time=%d Track=%d %s", &time, &trackIndex, msgType) >= 3) {
-            if (std::string(msgType) == "note_on" || std::string(msgType) == "note_off") {
-                if (sscanf(line.c_str(), "Time=%d Track=%d %s channel=%d note=%d velocity=%d",
-                           &time, &trackIndex, msgType, &channel, &note, &velocity) == 6) {
-                    if (trackIndex >= totalTracks) {
-                        std::cerr << "Índice de pista inválido " << trackIndex << std::endl;
-                        continue;
-                    }
-                    if (std::string(msgType) == "note_on" && velocity > 0) {
-                        NoteEvent newNote;
-                        newNote.note = note;
-                        newNote.startTime = time;
-                        newNote.endTime = -1;
-                        tracks[trackIndex].notes.push_back(newNote);
-                    } else {
-                        for (auto& n : tracks[trackIndex].notes) {
-                            if (n.note == note && n.endTime == -1) {
-                                n.endTime = time;
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    // Establecer endTime para notas que no lo tienen
-    int maxTime = 0;
-    for (const auto& track : tracks) {
-        for (const auto& note : track.notes) {
-            if (note.endTime > maxTime) {
-                maxTime = note.endTime;
-            }
-        }
-    }
-    for (auto& track : tracks) {
-        for (auto& note : track.notes) {
-            if (note.endTime == -1) {
-                note.endTime = maxTime;
-            }
-        }
-    }
-
-    file.close();
-    return tracks;
-}
-
 // Determina el tipo de forma basado en la octava de la nota
 ShapeType determineShapeType(int note) {
     int octave = (note / 12) - 1;
@@ -264,45 +188,38 @@ ShapeType determineShapeType(int note) {
     }
 }
 
-// Procesa una pista para crear formas basadas en las notas
-void processTrack(Track& track, int trackIndex, float currentTimeSeconds, RtMidiOut& midiout, 
-                 float ticksPerSecond, std::vector<NoteShape>& activeShapes) {
-    for (auto& note : track.notes) {
-        float noteStartTimeSeconds = note.startTime / ticksPerSecond;
-        float noteEndTimeSeconds = note.endTime / ticksPerSecond;
+// Crea la forma de una nota en el cuadrado de su pista
+void addNoteShape(int trackIndex, int note, std::vector<NoteShape>& activeShapes) {
+    ShapeType type = determineShapeType(note);
 
-        // Activar nota
-        if (!note.noteOnSent && currentTimeSeconds >= noteStartTimeSeconds) {
-            std::vector<unsigned char> message = { 0x90, static_cast<unsigned char>(note.note), 64 };
-            midiout.sendMessage(&message);
-            note.noteOnSent = true;
-
-            ShapeType type = determineShapeType(note.note);
+    int row = trackIndex / GRID_COLS;
+    int col = trackIndex % GRID_COLS;
+    float squareX = col * SQUARE_WIDTH;
+    float squareY = row * SQUARE_HEIGHT;
 
-            int row = trackIndex / GRID_COLS;
-            int col = trackIndex % GRID_COLS;
-            float squareX = col * SQUARE_WIDTH;
-            float squareY = row * SQUARE_HEIGHT;
+    sf::Vector2f startPosition(squareX + SQUARE_WIDTH / 2.0f, squareY + SQUARE_HEIGHT / 2.0f);
 
-            sf::Vector2f startPosition(squareX + SQUARE_WIDTH / 2.0f, squareY + SQUARE_HEIGHT / 2.0f);
-
-            sf::Color noteColor = setColorByOctave(note.note);
-            std::cout << "Nota Activada: " << note.note << ", Color Asignado: (" 
-                      << static_cast<int>(noteColor.r) << ", " 
-                      << static_cast<int>(noteColor.g) << ", " 
-                      << static_cast<int>(noteColor.b) << ")" << std::endl;
+    sf::Color noteColor = setColorByOctave(note);
+    float growthRate = (SHAPE_MAX_SCALE - SHAPE_INITIAL_SCALE) / SHAPE_GROW_DURATION;
+    activeShapes.emplace_back(type, noteColor, startPosition, growthRate);
+}
 
-            float growthRate = (SHAPE_MAX_SCALE - SHAPE_INITIAL_SCALE) / SHAPE_GROW_DURATION;
-            activeShapes.emplace_back(type, noteColor, startPosition, growthRate);
-        }
+// Procesa una pista para crear formas basadas en las notas
+void processTrack(NoteScheduler& scheduler, int trackIndex, std::int64_t currentTick, std::vector<NoteShape>& activeShapes, const TrackFilter& trackFilter) {
+    scheduler.advance(currentTick,
+        // Activar nota
+        [&](const NoteEvent& note) {
+            if (!trackFilter.audible(trackIndex, note.channel)) {
+                return;
+            }
+            addNoteShape(trackIndex, note.note, activeShapes);
+        },
 
         // Desactivar nota
-        if (!note.noteOffSent && currentTimeSeconds >= noteEndTimeSeconds) {
-            std::vector<unsigned char> message = { 0x80, static_cast<unsigned char>(note.note), 64 };
-            midiout.sendMessage(&message);
-            note.noteOffSent = true;
-            std::cout << "Nota Desactivada: " << note.note << std::endl;
-
+        [&](const NoteEvent& note) {
+            if (!trackFilter.audible(trackIndex, note.channel)) {
+                return;
+            }
             // Eliminar el NoteShape correspondiente
             // Asumimos que cada nota activa corresponde a un NoteShape
             // Buscamos la primera forma que tenga el mismo color que la nota
@@ -316,30 +233,45 @@ void processTrack(Track& track, int trackIndex, float currentTimeSeconds, RtMidi
             if (it != activeShapes.end()) {
                 it->active = false; // Marcar para eliminación
             }
-        }
-    }
+        });
 }
 
 int main(int argc, char* argv[]) {
+    // --headless: sin ventana ni MIDI, reloj simulado lo más rápido posible
+    bool headless = takeFlag(argc, argv, "--headless");
+
+    // --loop A:B: repite sin fin los compases A a B (o los ticks At:Bt)
+    std::string loopText;
+    bool looping = takeOption(argc, argv, "--loop", loopText);
+
+    // --ports N, --virtual, --routes tabla: reparto de las pistas entre puertos MIDI
+    MidiOutputOptions midiOptions;
+    if (!takeMidiOutputOptions(argc, argv, midiOptions)) {
+        return -1;
+    }
+
     if (argc != 3) {
-        std::cerr << "Uso: " << argv[0] << " <ruta al archivo .crim2s> <bpm>" << std::endl;
+        printPlaybackUsage(argv[0]);
         return -1;
     }
 
     std::string crim2sFilePath = argv[1];
     float bpm = std::stof(argv[2]);
 
-    // Inicializar RtMidiOut
-    RtMidiOut midiout;
-    unsigned int nPorts = midiout.getPortCount();
-    if (nPorts == 0) {
-        std::cout << "No hay puertos MIDI disponibles.\n";
+    // Sin ventana ni puertos MIDI: se mide antes de abrir nada
+    if (headless) {
+        return runHeadlessFile(crim2sFilePath, bpm);
+    }
+
+    // Abrir los puertos de salida MIDI
+    RtMidiPorts midiPorts;
+    if (!midiPorts.open(midiOptions.ports, midiOptions.virtualPorts)) {
         return -1;
     }
-    midiout.openPort(0);
 
     int ticksPerBeat = 480; 
-    std::vector<Track> tracks = readCrim2sFile(crim2sFilePath, ticksPerBeat);
+    std::vector<TempoEvent> tempoEvents;
+    std::vector<Track> tracks = loadSongFile(crim2sFilePath, ticksPerBeat, &tempoEvents);
     if (tracks.empty()) {
         std::cerr << "Error: no se encontraron pistas en el archivo." << std::endl;
         return -1;
@@ -351,8 +283,25 @@ int main(int argc, char* argv[]) {
         tracks.resize(TOTAL_TRACKS);
     }
 
-    float beatsPerSecond = bpm / 60.0f;
-    float ticksPerSecond = ticksPerBeat * beatsPerSecond;
+    // Mapa de tempo del archivo; los BPM indicados valen hasta el primer set_tempo
+    TempoMap tempoMap(ticksPerBeat, tempoEvents, bpmToMicrosecondsPerBeat(bpm));
+
+    // Bucle A/B opcional
+    LoopRegion loop;
+    if (looping && !parseLoopRegion(loopText, tempoMap, loop)) {
+        return -1;
+    }
+
+    // Un planificador por pista: cada fotograma solo toca las notas que empiezan o terminan
+    std::vector<NoteScheduler> schedulers(tracks.begin(), tracks.end());
+
+    // Reloj de reproducción compartido por el envío MIDI y el dibujo
+    PlaybackClock playbackClock;
+
+    MidiRouter midiSink(midiPorts.sinks(), midiOptions.routing);
+
+    // Envío MIDI en su propio hilo, a la hora exacta de cada evento; el dibujo sigue su reloj
+    MidiDispatcher dispatcher(Timeline(tracks), tempoMap, playbackClock, midiSink);
 
     sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "Vista Transversal MIDI");
     window.setFramerateLimit(60);
@@ -360,7 +309,6 @@ int main(int argc, char* argv[]) {
     // Vector para almacenar las formas activas por pista
     std::vector<std::vector<NoteShape>> trackActiveShapes(TOTAL_TRACKS);
 
-    sf::Clock totalClock;  
     sf::Clock deltaClock;  
 
     // Definir color fijo para los cuadrados de la cuadrícula (gris oscuro)
@@ -379,6 +327,23 @@ int main(int argc, char* argv[]) {
         gridBackgrounds[trackIndex] = background;
     }
 
+    // Silencio y solo en vivo: lo silenciado (pista o canal) no se envía ni se dibuja
+    TrackFilter trackFilter;
+    dispatcher.setTrackFilter(trackFilter);
+    PlaybackControls controls(playbackClock, dispatcher, trackFilter);
+
+    dispatcher.setLoop(loop);
+    if (loop.active()) {
+        for (NoteScheduler& scheduler : schedulers) {
+            scheduler.setLoop(loop.startTick());
+        }
+    }
+    std::int64_t drawnLap = 0; // Vueltas al bucle ya dibujadas
+
+    // Arranca el reloj de la canción y el envío MIDI
+    playbackClock.start();
+    dispatcher.start();
+
     while (window.isOpen()) {
         float deltaTime = deltaClock.restart().asSeconds();
 
@@ -386,13 +351,51 @@ int main(int argc, char* argv[]) {
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();
+            else if (event.type == sf::Event::KeyPressed) {
+                // Tras un salto o un cambio de silencio
+                if (controls.keyPressed(event.key)) {
+                    // Rehacer las formas con las notas que suenan ahora en las pistas audibles
+                    std::int64_t seekTick = tempoMap.microsToTick(loop.wrap(playbackClock.micros(), drawnLap));
+                    for (int i = 0; i < TOTAL_TRACKS; ++i) {
+                        trackActiveShapes[i].clear();
+                        if (trackFilter.trackAudible(i)) {
+                            schedulers[i].seek(seekTick, [&](const NoteEvent& note) {
+                                if (trackFilter.audible(i, note.channel)) {
+                                    addNoteShape(i, note.note, trackActiveShapes[i]);
+                                }
+                            });
+                        }
+                    }
+                }
+            }
         }
+        controls.apply();
+
+        // Tick actual según el mapa de tempo (microsegundos enteros)
+        std::int64_t lap = 0;
+        std::int64_t songMicros = loop.wrap(playbackClock.micros(), lap);
+        if (lap != drawnLap) {
+            // Vuelta del bucle: se suelta todo y se recupera lo que suena en su inicio
+            for (int i = 0; i < TOTAL_TRACKS; ++i) {
+                trackActiveShapes[i].clear();
+                if (trackFilter.trackAudible(i)) {
+                    schedulers[i].wrap([&](const NoteEvent& note) {
+                        if (trackFilter.audible(i, note.channel)) {
+                            addNoteShape(i, note.note, trackActiveShapes[i]);
+                        }
+                    });
+                }
+            }
+            drawnLap = lap;
+        }
+        std::int64_t currentTick = tempoMap.microsToTick(songMicros);
 
-        float currentTimeSeconds = totalClock.getElapsedTime().asSeconds();
-
-        // Procesar cada pista
+        // Procesar cada pista; las silenciadas ni se calculan (se rehacen al volver a sonar)
         for (int i = 0; i < TOTAL_TRACKS; ++i) {
-            processTrack(tracks[i], i, currentTimeSeconds, midiout, ticksPerSecond, trackActiveShapes[i]);
+            if (!trackFilter.trackAudible(i)) {
+                continue;
+            }
+            processTrack(schedulers[i], i, currentTick, trackActiveShapes[i], trackFilter);
         }
 
         // Actualizar las formas activas y eliminar las inactivas
@@ -439,5 +442,8 @@ int main(int argc, char* argv[]) {
         window.display();
     }
 
+    dispatcher.stop();
+    dispatcher.printSendStats(std::cout);
+    midiSink.printPortStats(std::cout);
     return 0;
 }
@@ -10,6 +10,17 @@
 #include <algorithm>
 #include <sstream>
 #include <unordered_map>
+#include "crim2sLoader/songFile.h"
+#include "crim2sLoader/commandLine.h"
+#include "crim2sLoader/headlessPlayback.h"
+#include "crim2sLoader/loopRegion.h"
+#include "crim2sLoader/midiDispatcher.h"
+#include "crim2sLoader/midiRouter.h"
+#include "crim2sLoader/playbackControls.h"
+#include "crim2sLoader/rtMidiSink.h"
+#include "crim2sLoader/noteScheduler.h"
+#include "crim2sLoader/tempoMap.h"
+#include "crim2sLoader/trackFilter.h"
 
 // -------------------------- Constantes --------------------------
 const int WINDOW_WIDTH = 1200;
@@ -22,20 +33,6 @@ const float SHAPE_INITIAL_SCALE = 0.1f; // Escala inicial
 
 // -------------------------- Estructuras --------------------------
 
-// Estructura para representar un evento de nota
-struct NoteEvent {
-    int note;
-    int startTime;
-    int endTime;
-    bool noteOnSent = false;
-    bool noteOffSent = false;
-};
-
-// Estructura para representar una pista
-struct Track {
-    std::vector<NoteEvent> notes;
-};
-
 // Estructura para representar una forma dinámica asociada a un nodo
 struct NoteShape {
     std::shared_ptr<sf::Shape> shape;
@@ -125,154 +122,50 @@ sf::Color setColorByOctaveLinealAbss2(int note) {
                      static_cast<sf::Uint8>(colors[note % 12][2]));
 }
 
-// Lee el archivo .crim2s y devuelve las pistas
-std::vector<Track> readCrim2sFile(const std::string& filename, int& ticksPerBeat) {
-    std::ifstream file(filename);
-    std::vector<Track> tracks;
-    if (!file.is_open()) {
-        std::cerr << "Error al abrir el archivo " << filename << std::endl;
-        return tracks;
-    }
-    std::string line;
-    int totalTracks = 0;
-    // Leer información del encabezado
-    while (std::getline(file, line)) {
-        if (line.find("Ticks per beat:") != std::string::npos) {
-            sscanf(line.c_str(), "Ticks per beat: %d", &ticksPerBeat);
-        }
-        else if (line.find("Número de pistas:") != std::string::npos) {
-            sscanf(line.c_str(), "Número de pistas: %d", &totalTracks);
-            tracks.resize(totalTracks);
-        }
-        else if (line.find("Eventos:") != std::string::npos) {
-            break;
-        }
-    }
+// Crea la forma de una nota en el nodo del árbol de su pista
+void addNoteShape(int trackIndex, int note, std::vector<std::shared_ptr<NoteShape>>& shapes) {
+    // Obtener el color de la nota
+    sf::Color noteColor = setColorByOctaveLinealAbss2(note);
 
-    // Leer los eventos
-    while (std::getline(file, line)) {
-        int time = 0, trackIndex = 0;
-        char msgType[16];
-        int channel = 0, note = 0, velocity = 0;
-        // Utilizar stringstream para mayor flexibilidad
-        std::stringstream ss(line);
-        std::string token;
-        ss >> token; // Time=...
-        if (token.find("Time=") == 0) {
-            time = std::stoi(token.substr(5));
-        }
-        ss >> token; // Track=...
-        if (token.find("Track=") == 0) {
-            trackIndex = std::stoi(token.substr(6));
-        }
-        ss >> token; // msgType
-        strcpy(msgType, token.c_str());
-        if (std::string(msgType) == "note_on" || std::string(msgType) == "note_off") {
-            ss >> token; // channel=...
-            if (token.find("channel=") == 0) {
-                channel = std::stoi(token.substr(8));
-            }
-            ss >> token; // note=...
-            if (token.find("note=") == 0) {
-                note = std::stoi(token.substr(5));
-            }
-            ss >> token; // velocity=...
-            if (token.find("velocity=") == 0) {
-                velocity = std::stoi(token.substr(9));
-            }
+    // Calcular la posición del nodo en el árbol binario
+    // Suponiendo que trackIndex determina el nivel del árbol
+    int level = std::floor(std::log2(trackIndex + 1));
+    int positionInLevel = trackIndex - std::pow(2, level) + 1;
 
-            if (trackIndex >= totalTracks) {
-                std::cerr << "Índice de pista inválido " << trackIndex << std::endl;
-                continue;
-            }
+    float horizontalSpacing = WINDOW_WIDTH / std::pow(2, level + 1);
+    float xPos = horizontalSpacing + positionInLevel * horizontalSpacing * 2;
+    float yPos = 100.0f + level * 100.0f;
 
-            if (std::string(msgType) == "note_on" && velocity > 0) {
-                NoteEvent newNote;
-                newNote.note = note;
-                newNote.startTime = time;
-                newNote.endTime = -1;
-                tracks[trackIndex].notes.push_back(newNote);
-            }
-            else {
-                // Encontrar la nota y establecer endTime
-                for (auto& n : tracks[trackIndex].notes) {
-                    if (n.note == note && n.endTime == -1) {
-                        n.endTime = time;
-                        break;
-                    }
-                }
-            }
-        }
-    }
+    sf::Vector2f nodePosition(xPos, yPos);
 
-    // Establecer endTime para notas que no lo tienen
-    int maxTime = 0;
-    for (const auto& track : tracks) {
-        for (const auto& note : track.notes) {
-            if (note.endTime > maxTime) {
-                maxTime = note.endTime;
-            }
-        }
-    }
-    for (auto& track : tracks) {
-        for (auto& note : track.notes) {
-            if (note.endTime == -1) {
-                note.endTime = maxTime;
-            }
-        }
-    }
+    // Tasa de crecimiento para alcanzar el tamaño máximo en SHAPE_GROW_DURATION segundos
+    float growthRate = (SHAPE_MAX_SCALE - SHAPE_INITIAL_SCALE) / SHAPE_GROW_DURATION;
 
-    file.close();
-    return tracks;
+    // Crear la forma y añadirla al vector de formas
+    shapes.emplace_back(std::make_shared<NoteShape>(noteColor, nodePosition, growthRate));
 }
 
 // Procesa una pista para crear formas basadas en las notas
-void processTrack(Track& track, int trackIndex, float currentTimeSeconds, RtMidiOut& midiout, float ticksPerSecond, std::vector<std::shared_ptr<NoteShape>>& shapes) {
-    for (auto& note : track.notes) {
-        float noteStartTimeSeconds = note.startTime / ticksPerSecond;
-        float noteEndTimeSeconds = note.endTime / ticksPerSecond;
-
+void processTrack(NoteScheduler& scheduler, int trackIndex, std::int64_t currentTick, std::vector<std::shared_ptr<NoteShape>>& shapes, const TrackFilter& trackFilter) {
+    scheduler.advance(currentTick,
         // Activar nota
-        if (!note.noteOnSent && currentTimeSeconds >= noteStartTimeSeconds) {
-            // Enviar mensaje MIDI note_on
-            std::vector<unsigned char> message = { 0x90, static_cast<unsigned char>(note.note), 64 };
-            midiout.sendMessage(&message);
-            note.noteOnSent = true;
-
-            // Obtener el color de la nota
-            sf::Color noteColor = setColorByOctaveLinealAbss2(note.note);
-
-            // Calcular la posición del nodo en el árbol binario
-            // Suponiendo que trackIndex determina el nivel del árbol
-            int level = std::floor(std::log2(trackIndex + 1));
-            int positionInLevel = trackIndex - std::pow(2, level) + 1;
-
-            float horizontalSpacing = WINDOW_WIDTH / std::pow(2, level + 1);
-            float xPos = horizontalSpacing + positionInLevel * horizontalSpacing * 2;
-            float yPos = 100.0f + level * 100.0f;
-
-            sf::Vector2f nodePosition(xPos, yPos);
-
-            // Tasa de crecimiento para alcanzar el tamaño máximo en SHAPE_GROW_DURATION segundos
-            float growthRate = (SHAPE_MAX_SCALE - SHAPE_INITIAL_SCALE) / SHAPE_GROW_DURATION;
-
-            // Crear la forma y añadirla al vector de formas
-            shapes.emplace_back(std::make_shared<NoteShape>(noteColor, nodePosition, growthRate));
-        }
+        [&](const NoteEvent& note) {
+            if (!trackFilter.audible(trackIndex, note.channel)) {
+                return;
+            }
+            addNoteShape(trackIndex, note.note, shapes);
+        },
 
         // Desactivar nota
-        if (!note.noteOffSent && currentTimeSeconds >= noteEndTimeSeconds) {
-            // Enviar mensaje MIDI note_off
-            std::vector<unsigned char> message = { 0x80, static_cast<unsigned char>(note.note), 64 };
-            midiout.sendMessage(&message);
-            note.noteOffSent = true;
-
+        [&](const NoteEvent& note) {
+            if (!trackFilter.audible(trackIndex, note.channel)) {
+                return;
+            }
             // Remover la forma correspondiente
             if (!shapes.empty()) {
                 shapes.pop_back();
             }
-        }
-    }
+        });
 }
 
 // Construye el árbol binario basado en las pistas activas
@@ -335,36 +228,71 @@ void drawTree(sf::RenderWindow& window, std::shared_ptr<TreeNode> node) {
 }
 
 int main(int argc, char* argv[]) {
+    // --headless: sin ventana ni MIDI, reloj simulado lo más rápido posible
+    bool headless = takeFlag(argc, argv, "--headless");
+
+    // --loop A:B: repite sin fin los compases A a B (o los ticks At:Bt)
+    std::string loopText;
+    bool looping = takeOption(argc, argv, "--loop", loopText);
+
+    // --ports N, --virtual, --routes tabla: reparto de las pistas entre puertos MIDI
+    MidiOutputOptions midiOptions;
+    if (!takeMidiOutputOptions(argc, argv, midiOptions)) {
+        return -1;
+    }
+
     // Verificar argumentos de línea de comandos
     if (argc != 3) {
-        std::cerr << "Uso: " << argv[0] << " <ruta al archivo .crim2s> <bpm>" << std::endl;
+        printPlaybackUsage(argv[0]);
         return -1;
     }
     std::string crim2sFilePath = argv[1];
     float bpm = std::stof(argv[2]);
 
-    // Inicializar salida MIDI
-    RtMidiOut midiout;
-    unsigned int nPorts = midiout.getPortCount();
-    if (nPorts == 0) {
-        std::cout << "No hay puertos MIDI disponibles.\n";
+    // Sin ventana ni puertos MIDI: se mide antes de abrir nada
+    if (headless) {
+        return runHeadlessFile(crim2sFilePath, bpm);
+    }
+
+    // Abrir los puertos de salida MIDI
+    RtMidiPorts midiPorts;
+    if (!midiPorts.open(midiOptions.ports, midiOptions.virtualPorts)) {
         return -1;
     }
-    midiout.openPort(0);
     std::cout << "Conexión MIDI establecida correctamente entre RtMidi y FluidSynth.\n";
 
     // Leer el archivo .crim2s
     int ticksPerBeat = 480; // Valor por defecto, se actualizará al leer el archivo
-    std::vector<Track> tracks = readCrim2sFile(crim2sFilePath, ticksPerBeat);
+    std::vector<TempoEvent> tempoEvents;
+    std::vector<Track> tracks = loadSongFile(crim2sFilePath, ticksPerBeat, &tempoEvents);
     if (tracks.empty()) {
         std::cerr << "Error: no se encontraron pistas en el archivo.\n";
         return -1;
     }
+    if (tracks.size() < TOTAL_TRACKS) {
+        tracks.resize(TOTAL_TRACKS);
+    }
     std::cout << "[*] Extracción MIDI completada.\n";
 
-    // Calcular ticks por segundo
-    float beatsPerSecond = bpm / 60.0f;
-    float ticksPerSecond = ticksPerBeat * beatsPerSecond;
+    // Mapa de tempo del archivo; los BPM indicados valen hasta el primer set_tempo
+    TempoMap tempoMap(ticksPerBeat, tempoEvents, bpmToMicrosecondsPerBeat(bpm));
+
+    // Bucle A/B opcional
+    LoopRegion loop;
+    if (looping && !parseLoopRegion(loopText, tempoMap, loop)) {
+        return -1;
+    }
+
+    // Un planificador por pista: cada fotograma solo toca las notas que empiezan o terminan
+    std::vector<NoteScheduler> schedulers(tracks.begin(), tracks.end());
+
+    // Reloj de reproducción compartido por el envío MIDI y el dibujo
+    PlaybackClock playbackClock;
+
+    MidiRouter midiSink(midiPorts.sinks(), midiOptions.routing);
+
+    // Envío MIDI en su propio hilo, a la hora exacta de cada evento; el dibujo sigue su reloj
+    MidiDispatcher dispatcher(Timeline(tracks), tempoMap, playbackClock, midiSink);
 
     // Configurar ventana de visualización
     sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "Visualización de Árbol Binario MIDI (Solo Cuadrados)");
@@ -388,12 +316,28 @@ int main(int argc, char* argv[]) {
     // Variables para gestionar las formas activas por pista
     std::unordered_map<int, std::vector<std::shared_ptr<NoteShape>>> activeShapesMap; // trackIndex -> formas activas
 
-    // Reloj para el tiempo total y deltaTime
-    sf::Clock totalClock;  // Tiempo total transcurrido
+    // Reloj para el deltaTime (el tiempo de la canción lo lleva el dispatcher)
     sf::Clock deltaClock;  // DeltaTime entre frames
 
     std::cout << "[*] Inicio de la visualización.\n";
 
+    // Silencio y solo en vivo: lo silenciado (pista o canal) no se envía ni se dibuja
+    TrackFilter trackFilter;
+    dispatcher.setTrackFilter(trackFilter);
+    PlaybackControls controls(playbackClock, dispatcher, trackFilter);
+
+    dispatcher.setLoop(loop);
+    if (loop.active()) {
+        for (NoteScheduler& scheduler : schedulers) {
+            scheduler.setLoop(loop.startTick());
+        }
+    }
+    std::int64_t drawnLap = 0; // Vueltas al bucle ya dibujadas
+
+    // Arranca el reloj de la canción y el envío MIDI
+    playbackClock.start();
+    dispatcher.start();
+
     // Bucle principal
     while (window.isOpen()) {
         // Calcular deltaTime
@@ -404,14 +348,51 @@ int main(int argc, char* argv[]) {
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();
+            else if (event.type == sf::Event::KeyPressed) {
+                // Tras un salto o un cambio de silencio
+                if (controls.keyPressed(event.key)) {
+                    // Rehacer las formas con las notas que suenan ahora en las pistas audibles
+                    std::int64_t seekTick = tempoMap.microsToTick(loop.wrap(playbackClock.micros(), drawnLap));
+                    for (int i = 0; i < TOTAL_TRACKS; ++i) {
+                        activeShapesMap[i].clear();
+                        if (trackFilter.trackAudible(i)) {
+                            schedulers[i].seek(seekTick, [&](const NoteEvent& note) {
+                                if (trackFilter.audible(i, note.channel)) {
+                                    addNoteShape(i, note.note, activeShapesMap[i]);
+                                }
+                            });
+                        }
+                    }
+                }
+            }
         }
+        controls.apply();
+
+        // Tick actual según el mapa de tempo (microsegundos enteros)
+        std::int64_t lap = 0;
+        std::int64_t songMicros = loop.wrap(playbackClock.micros(), lap);
+        if (lap != drawnLap) {
+            // Vuelta del bucle: se suelta todo y se recupera lo que suena en su inicio
+            for (int i = 0; i < TOTAL_TRACKS; ++i) {
+                activeShapesMap[i].clear();
+                if (trackFilter.trackAudible(i)) {
+                    schedulers[i].wrap([&](const NoteEvent& note) {
+                        if (trackFilter.audible(i, note.channel)) {
+                            addNoteShape(i, note.note, activeShapesMap[i]);
+                        }
+                    });
+                }
+            }
+            drawnLap = lap;
+        }
+        std::int64_t currentTick = tempoMap.microsToTick(songMicros);
 
-        // Calcular tiempo actual en segundos
-        float currentTimeSeconds = totalClock.getElapsedTime().asSeconds();
-
-        // Actualizar cada pista
+        // Actualizar cada pista; las silenciadas ni se calculan (se rehacen al volver a sonar)
         for (int i = 0; i < TOTAL_TRACKS; ++i) {
-            processTrack(tracks[i], i, currentTimeSeconds, midiout, ticksPerSecond, activeShapesMap[i]);
+            if (!trackFilter.trackAudible(i)) {
+                continue;
+            }
+            processTrack(schedulers[i], i, currentTick, activeShapesMap[i], trackFilter);
         }
 
         // Actualizar formas
@@ -451,5 +432,8 @@ int main(int argc, char* argv[]) {
     // RtMidiOut se cerrará automáticamente al destructurarse
     std::cout << "Proceso completado.\n";
 
+    dispatcher.stop();
+    dispatcher.printSendStats(std::cout);
+    midiSink.printPortStats(std::cout);
     return 0;
 }
@@ -4,6 +4,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include "crim2sLoader/songFile.h"
 
 // -------------------------- Constantes --------------------------
 const int WINDOW_WIDTH = 800;
@@ -15,18 +16,6 @@ const float HORIZONTAL_SPACING = 400.0f; // Espaciado horizontal inicial
 
 // -------------------------- Estructuras --------------------------
 
-// Estructura para representar un evento de nota
-struct NoteEvent {
-    int note;
-    int startTime;
-    int endTime;
-};
-
-// Estructura para representar una pista
-struct Track {
-    std::vector<NoteEvent> notes;
-};
-
 // Enum para definir tipos de formas
 enum class ShapeType {
     Circle,
@@ -79,40 +68,6 @@ sf::Shape* createShape(ShapeType type, const sf::Vector2f& position, sf::Color c
     }
 }
 
-// Lee el archivo .crim2s y devuelve las pistas
-std::vector<Track> readCrim2sFile(const std::string& filename) {
-    std::ifstream file(filename);
-    std::vector<Track> tracks;
-    if (!file.is_open()) {
-        std::cerr << "Error al abrir el archivo: " << filename << std::endl;
-        return tracks;
-    }
-
-    std::string line;
-    int totalTracks = 0;
-
-    while (std::getline(file, line)) {
-        if (line.find("Número de pistas:") != std::string::npos) {
-            sscanf(line.c_str(), "Número de pistas: %d", &totalTracks);
-            tracks.resize(totalTracks);
-        } else if (line.find("Eventos:") != std::string::npos) {
-            break;
-        }
-    }
-
-    while (std::getline(file, line)) {
-        int trackIndex = 0, note = 0;
-        if (sscanf(line.c_str(), "Track=%d note=%d", &trackIndex, &note) == 2) {
-            if (trackIndex >= totalTracks) continue;
-            NoteEvent event;
-            event.note = note;
-            tracks[trackIndex].notes.push_back(event);
-        }
-    }
-
-    return tracks;
-}
-
 // Genera el árbol visual
 void generateTree(const std::vector<Track>& tracks, sf::RenderWindow& window) {
     std::vector<sf::Shape*> shapes;
@@ -161,13 +116,14 @@ void generateTree(const std::vector<Track>& tracks, sf::RenderWindow& window) {
 
 int main(int argc, char* argv[]) {
     if (argc != 2) {
-        std::cerr << "Uso: " << argv[0] << " <ruta al archivo .crim2s>" << std::endl;
+        std::cerr << "Uso: " << argv[0] << " <ruta al archivo .mid, .crim2s, .crim2b o .crim2z>" << std::endl;
         return -1;
     }
 
     std::string crim2sFilePath = argv[1];
 
-    auto tracks = readCrim2sFile(crim2sFilePath);
+    int ticksPerBeat = 480;
+    auto tracks = loadSongFile(crim2sFilePath, ticksPerBeat);
     if (tracks.empty()) {
         std::cerr << "Error: No se pudieron leer las pistas del archivo." << std::endl;
         return -1;
@@ -4,11 +4,11 @@
 #include <iostream>
 #include <sstream>
 #include <thread>
-#include <mutex>
-#include <queue>
 #include <atomic>
 #include <cmath>
 #include "../colorFunctions/colorFunctions.h"
+#include "../crim2sLoader/parseDiagnostics.h"
+#include "../crim2sLoader/spscRing.h"
 
 // -------------------------- Constantes --------------------------
 const int WINDOW_WIDTH = 800;
@@ -26,9 +26,15 @@ struct Crim2sEvent {
     int channel;
 };
 
-// Cola segura para hilos
-std::queue<Crim2sEvent> eventQueue;
-std::mutex queueMutex;
+// Cambio de estado de una nota, lo único que necesita el dibujo
+struct NoteChange {
+    int note;
+    int velocity;
+    bool noteOn;
+};
+
+// Cola sin bloqueos entre el hilo lector (productor) y el de dibujo (consumidor)
+SpscRing<NoteChange, 4096> noteChanges;
 std::atomic<bool> running(true);
 
 // -------------------------- Funciones --------------------------
@@ -40,11 +46,16 @@ void readCrim2sPipe(const std::string& pipePath) {
         return;
     }
 
+    // Solo se cuenta en el bucle; el resumen se escribe al cerrarse el pipe
+    ParseDiagnostics diagnostics;
+    std::uint64_t receivedLines = 0;
+    std::uint64_t processedEvents = 0;
+    std::uint64_t droppedEvents = 0;
+
     std::string line;
     while (running && std::getline(pipe, line)) {
         if (line.empty()) continue;
-
-        std::cout << "Línea recibida: " << line << std::endl; // Depuración
+        ++receivedLines;
 
         Crim2sEvent event;
         std::istringstream iss(line);
@@ -86,23 +97,21 @@ void readCrim2sPipe(const std::string& pipePath) {
             event.extraTime = std::stoi(msg.substr(5));
 
 
-            // Agregar evento a la cola
-            {
-                std::lock_guard<std::mutex> lock(queueMutex);
-                eventQueue.push(event);
+            // Agregar evento a la cola; si el dibujo va retrasado y está llena, se descarta
+            if (!noteChanges.push({event.note, event.velocity, event.msgType == "note_on"})) {
+                ++droppedEvents;
             }
 
-            std::cout << "Evento procesado: Time=" << event.time
-                      << ", Track=" << event.track
-                      << ", MsgType=" << event.msgType
-                      << ", Note=" << event.note
-                      << ", Velocity=" << event.velocity
-                      << ", ExtraTime=" << event.extraTime << std::endl;
+            ++processedEvents;
 
         } catch (const std::exception& e) {
-            std::cerr << "Error al procesar mensaje: " << e.what() << " en línea: " << line << std::endl;
+            diagnostics.report(ParseIssue::MalformedLine, receivedLines, std::string(e.what()) + ": " + line);
         }
     }
+
+    std::cout << "Líneas recibidas: " << receivedLines << ", eventos procesados: " << processedEvents
+              << ", descartados por cola llena: " << droppedEvents << "\n";
+    diagnostics.printSummary(std::cerr, pipePath);
 }
 
 
@@ -111,15 +120,11 @@ void readCrim2sPipe(const std::string& pipePath) {
 sf::Color processEvents(sf::Color currentColor) {
     std::vector<sf::Color> colorsToMix;
 
-    std::lock_guard<std::mutex> lock(queueMutex);
-    while (!eventQueue.empty()) {
-        Crim2sEvent crimEvent = eventQueue.front();
-        eventQueue.pop();
-
-        if (crimEvent.msgType == "note_on" && crimEvent.velocity > 0) {
-            colorsToMix.push_back(setColorByOctave(crimEvent.note));
+    noteChanges.drain([&](const NoteChange& change) {
+        if (change.noteOn && change.velocity > 0) {
+            colorsToMix.push_back(setColorByOctave(change.note));
         }
-    }
+    });
 
     if (!colorsToMix.empty()) {
         return applyMixingStrategy(colorsToMix, mixColorsAverage); // Usa la estrategia deseada
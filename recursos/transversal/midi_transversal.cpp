@@ -6,18 +6,17 @@
 #include <rtmidi/RtMidi.h>
 #include <mutex>
 #include "../colorFunctions/colorFunctions.h"  // Asegúrate de que este archivo está correctamente incluido
-
-struct NoteEvent {
-    int note;
-    int startTime;
-    int endTime;
-    bool noteOnSent = false;
-    bool noteOffSent = false;
-};
-
-struct Track {
-    std::vector<NoteEvent> notes;
-};
+#include "../crim2sLoader/songFile.h"
+#include "../crim2sLoader/crim2sStream.h"
+#include "../crim2sLoader/commandLine.h"
+#include "../crim2sLoader/headlessPlayback.h"
+#include "../crim2sLoader/loopRegion.h"
+#include "../crim2sLoader/midiDispatcher.h"
+#include "../crim2sLoader/midiRouter.h"
+#include "../crim2sLoader/playbackControls.h"
+#include "../crim2sLoader/rtMidiSink.h"
+#include "../crim2sLoader/tempoMap.h"
+#include "../crim2sLoader/trackFilter.h"
 
 struct TrackState {
     int activeNotes = 0;
@@ -25,95 +24,38 @@ struct TrackState {
     std::vector<sf::Color> activeNoteColors;
 };
 
-// Función para leer el archivo .crim2s y extraer las pistas y eventos
-std::vector<Track> readCrim2sFile(const std::string& filename, int& ticksPerBeat) {
-    std::ifstream file(filename);
-    std::vector<Track> tracks;
-    if (!file.is_open()) {
-        std::cerr << "Error al abrir el archivo " << filename << std::endl;
-        return tracks;
-    }
-    std::string line;
-    int totalTracks = 0;
-    // Leer información del encabezado
-    while (std::getline(file, line)) {
-        if (line.find("Ticks per beat:") != std::string::npos) {
-            sscanf(line.c_str(), "Ticks per beat: %d", &ticksPerBeat);
-        } else if (line.find("Número de pistas:") != std::string::npos) {
-            sscanf(line.c_str(), "Número de pistas: %d", &totalTracks);
-            tracks.resize(totalTracks);
-        } else if (line.find("Eventos:") != std::string::npos) {
-            break;
-        }
-    }
+int main(int argc, char* argv[]) {
+    // --headless: sin ventana ni MIDI, reloj simulado lo más rápido posible
+    bool headless = takeFlag(argc, argv, "--headless");
 
-    // Leer los eventos
-    while (std::getline(file, line)) {
-        int time = 0, trackIndex = 0;
-        char msgType[16];
-        int channel = 0, note = 0, velocity = 0;
-        // Modificar el sscanf para ignorar el último campo time=<int>
-        if (sscanf(line.c_str(), "Time=%d Track=%d %s channel=%d note=%d velocity=%d time=%*d",
-                   &time, &trackIndex, msgType, &channel, &note, &velocity) == 6) {
-            if (trackIndex >= totalTracks) {
-                std::cerr << "Índice de pista inválido " << trackIndex << std::endl;
-                continue;
-            }
-            if (std::string(msgType) == "note_on" && velocity > 0) {
-                NoteEvent newNote;
-                newNote.note = note;
-                newNote.startTime = time;
-                newNote.endTime = -1;
-                tracks[trackIndex].notes.push_back(newNote);
-            } else if (std::string(msgType) == "note_off" || (std::string(msgType) == "note_on" && velocity == 0)) {
-                // Encontrar la nota y establecer endTime
-                bool found = false;
-                for (auto& n : tracks[trackIndex].notes) {
-                    if (n.note == note && n.endTime == -1) {
-                        n.endTime = time;
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found) {
-                    std::cerr << "Nota_off encontrada sin nota_on correspondiente: Nota=" << note << std::endl;
-                }
-            }
-        }
-    }
+    // --stream: lee el .crim2s por ventanas mientras suena
+    bool streaming = takeFlag(argc, argv, "--stream");
 
-    // Establecer endTime para notas que no lo tienen
-    int maxTime = 0;
-    for (const auto& track : tracks) {
-        for (const auto& note : track.notes) {
-            if (note.endTime > maxTime) {
-                maxTime = note.endTime;
-            }
-        }
-    }
-    for (auto& track : tracks) {
-        for (auto& note : track.notes) {
-            if (note.endTime == -1) {
-                note.endTime = maxTime;
-            }
-        }
-    }
+    // --loop A:B: repite sin fin los compases A a B (o los ticks At:Bt)
+    std::string loopText;
+    bool looping = takeOption(argc, argv, "--loop", loopText);
 
-    file.close();
-    return tracks;
-}
+    // --ports N, --virtual, --routes tabla: reparto de las pistas entre puertos MIDI
+    MidiOutputOptions midiOptions;
+    if (!takeMidiOutputOptions(argc, argv, midiOptions)) {
+        return -1;
+    }
 
-int main(int argc, char* argv[]) {
     // Verificar que el usuario proporcione el archivo de entrada, los BPM y la estrategia de mezcla
     if (argc != 4) {
-        std::cerr << "Uso: " << argv[0] << " <ruta al archivo .crim2s> <bpm> <mix_strategy>" << std::endl;
-        std::cerr << "mix_strategy: sum | average" << std::endl;
+        printPlaybackUsage(argv[0], " <mix_strategy> [--stream]",
+                           {"mix_strategy: sum | average",
+                            "--stream: lee el .crim2s por ventanas mientras suena (memoria constante)"});
         return -1;
     }
     std::string crim2sFilePath = argv[1];
     float bpm = std::stof(argv[2]);
     std::string mixStrategy = argv[3];
 
+    if (headless) {
+        return runHeadlessFile(crim2sFilePath, bpm);
+    }
+
     // Seleccionar la función de mezcla basada en el parámetro
     typedef sf::Color (*MixFunction)(const sf::Color&, const sf::Color&);
     MixFunction mixFunc = nullptr;
@@ -128,32 +70,62 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
-    // Inicializa salida MIDI
-    RtMidiOut midiout;
-    unsigned int nPorts = midiout.getPortCount();
-    if (nPorts == 0) {
-        std::cout << "No hay puertos MIDI disponibles.\n";
+    // Abrir los puertos de salida MIDI
+    RtMidiPorts midiPorts;
+    if (!midiPorts.open(midiOptions.ports, midiOptions.virtualPorts)) {
         return -1;
     }
-    midiout.openPort(0);
 
     int ticksPerBeat = 480; // Valor por defecto, se actualizará al leer el archivo
-    std::vector<Track> tracks = readCrim2sFile(crim2sFilePath, ticksPerBeat);
-    std::cout << "Número de pistas leídas: " << tracks.size() << std::endl; // Depuración
-    if (tracks.empty()) {
+    std::vector<Track> tracks;
+    std::vector<TempoEvent> tempoEvents;
+    Crim2sStream stream;
+    int numTracks = 0;
+    if (streaming) {
+        if (!hasExtension(crim2sFilePath, ".crim2s")) {
+            std::cerr << "Error: --stream solo admite archivos .crim2s" << std::endl;
+            return -1;
+        }
+        // Primera ventana de STREAM_WINDOW_SECONDS segundos al tempo inicial; después hace
+        // de ventana la cola de tamaño fijo del dispatcher (ver Crim2sStream::feed)
+        const float STREAM_WINDOW_SECONDS = 10.0f;
+        if (!stream.open(crim2sFilePath, STREAM_WINDOW_SECONDS * bpm / 60.0f)) {
+            return -1;
+        }
+        ticksPerBeat = stream.ticksPerBeat();
+        numTracks = stream.trackCount();
+    } else {
+        tracks = loadSongFile(crim2sFilePath, ticksPerBeat, &tempoEvents);
+        numTracks = tracks.size();
+    }
+    std::cout << "Número de pistas leídas: " << numTracks << std::endl; // Depuración
+    if (numTracks == 0) {
         std::cerr << "Error: no se encontraron pistas en el archivo." << std::endl;
         return -1;
     }
 
-    // Calcula ticks por segundo
-    float beatsPerSecond = bpm / 60.0f;
-    float ticksPerSecond = ticksPerBeat * beatsPerSecond;
+    // Mapa de tempo del archivo; los BPM indicados valen hasta el primer set_tempo.
+    // En modo streaming los set_tempo se añaden según van llegando.
+    TempoMap tempoMap(ticksPerBeat, tempoEvents, bpmToMicrosecondsPerBeat(bpm));
+
+    // Bucle A/B opcional
+    if (looping && streaming) {
+        std::cerr << "Error: --loop no admite --stream" << std::endl;
+        return -1;
+    }
+    LoopRegion loop;
+    if (looping && !parseLoopRegion(loopText, tempoMap, loop)) {
+        return -1;
+    }
+
+    // Todos los note_on/note_off en un solo arreglo ordenado; las pistas ya no hacen falta
+    Timeline timeline(tracks);
+    std::vector<Track>().swap(tracks);
 
     // Configura ventana de visualización
     sf::RenderWindow window(sf::VideoMode(800, 600), "Vista Transversal MIDI");
 
     // Define parámetros de visualización
-    int numTracks = tracks.size();
     float rectWidth = 750.0f; // Ancho de los rectángulos
     float rectHeight = 30.0f; // Altura de los rectángulos
     float rectSpacing = 10.0f; // Espacio entre rectángulos
@@ -170,8 +142,74 @@ int main(int argc, char* argv[]) {
         trackRectangles.push_back(rect);
     }
 
-    // Clock para controlar el tiempo
-    sf::Clock clock;
+    MidiRouter midiSink(midiPorts.sinks(), midiOptions.routing);
+
+    // Activa una nota en la pista i: mezcla su color
+    auto startNote = [&](int i, int noteNumber) {
+        // Incrementar contador de notas activas
+        trackStates[i].activeNotes += 1;
+
+        // Obtener el color de la nota
+        sf::Color noteColor = setColorByOctaveBlue(noteNumber);
+
+        // Agregar el color al vector de colores activos
+        trackStates[i].activeNoteColors.push_back(noteColor);
+
+        // Recalcular el color actual usando la estrategia de mezcla
+        trackStates[i].currentColor = applyMixingStrategy(trackStates[i].activeNoteColors, mixFunc);
+
+        // Actualizar el color del rectángulo
+        trackRectangles[i].setFillColor(trackStates[i].currentColor);
+    };
+
+    // Libera una nota en la pista i: quita su color de la mezcla
+    auto stopNote = [&](int i, int noteNumber) {
+        // Decrementar contador de notas activas
+        if (trackStates[i].activeNotes > 0) {
+            trackStates[i].activeNotes -= 1;
+        }
+
+        // Obtener el color de la nota
+        sf::Color noteColor = setColorByOctaveBlue(noteNumber);
+
+        // Remover el color del vector de colores activos
+        // Busca la primera ocurrencia del color y lo elimina
+        auto it = std::find(trackStates[i].activeNoteColors.begin(), trackStates[i].activeNoteColors.end(), noteColor);
+        if (it != trackStates[i].activeNoteColors.end()) {
+            trackStates[i].activeNoteColors.erase(it);
+        } else {
+            std::cerr << "Advertencia: color de nota no encontrado en activeNoteColors para la pista " << i << std::endl;
+        }
+
+        // Recalcular el color actual usando la estrategia de mezcla
+        if (!trackStates[i].activeNoteColors.empty()) {
+            trackStates[i].currentColor = applyMixingStrategy(trackStates[i].activeNoteColors, mixFunc);
+        } else {
+            trackStates[i].currentColor = sf::Color::Black;
+        }
+
+        // Actualizar el color del rectángulo
+        trackRectangles[i].setFillColor(trackStates[i].currentColor);
+    };
+
+    // Reloj de reproducción compartido por el envío MIDI y el dibujo
+    PlaybackClock playbackClock;
+
+    // Envío MIDI en su propio hilo, a la hora exacta de cada evento; el bucle de dibujo
+    // solo refleja lo enviado. En streaming la línea de tiempo está vacía y los
+    // eventos le llegan al hilo de envío desde el lector, ya emparejados.
+    MidiDispatcher dispatcher(std::move(timeline), tempoMap, playbackClock, midiSink);
+    dispatcher.setLoop(loop);
+    TrackFilter trackFilter; // Silencio y solo en vivo: lo silenciado no se envía ni llega al dibujo
+    dispatcher.setTrackFilter(trackFilter);
+    PlaybackControls controls(playbackClock, dispatcher, trackFilter);
+    if (streaming) {
+        dispatcher.setStream(stream);
+        stream.waitReady(); // Empezar en cuanto esté leída la primera ventana
+    }
+    std::vector<TimelineEvent> sentEvents;
+    playbackClock.start();
+    dispatcher.start();
 
     // Bucle principal de la ventana
     while (window.isOpen()) {
@@ -179,70 +217,22 @@ int main(int argc, char* argv[]) {
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();
+            else if (event.type == sf::Event::KeyPressed) {
+                // El dispatcher apaga lo que sonaba y enciende lo que suena tras un salto
+                // o un cambio de silencio; los colores se rehacen al reflejar esos eventos.
+                controls.keyPressed(event.key);
+            }
         }
-
-        // Tiempo actual en ticks
-        float currentTimeSeconds = clock.getElapsedTime().asSeconds();
-        int currentTimeTicks = static_cast<int>(currentTimeSeconds * ticksPerSecond);
-
-        // Procesar eventos de notas
-        for (int i = 0; i < numTracks; ++i) {
-            for (auto& note : tracks[i].notes) {
-                if (!note.noteOnSent && currentTimeTicks >= note.startTime) {
-                    // Enviar note_on
-                    std::vector<unsigned char> message = {0x90, static_cast<unsigned char>(note.note), 64};
-                    midiout.sendMessage(&message);
-                    note.noteOnSent = true;
-
-                    // Incrementar contador de notas activas
-                    trackStates[i].activeNotes += 1;
-
-                    // Obtener el color de la nota
-                    sf::Color noteColor = setColorByOctaveBlue(note.note);
-
-                    // Agregar el color al vector de colores activos
-                    trackStates[i].activeNoteColors.push_back(noteColor);
-
-                    // Recalcular el color actual usando la estrategia de mezcla
-                    trackStates[i].currentColor = applyMixingStrategy(trackStates[i].activeNoteColors, mixFunc);
-
-                    // Actualizar el color del rectángulo
-                    trackRectangles[i].setFillColor(trackStates[i].currentColor);
-                }
-
-                if (!note.noteOffSent && currentTimeTicks >= note.endTime) {
-                    // Enviar note_off
-                    std::vector<unsigned char> message = {0x80, static_cast<unsigned char>(note.note), 64};
-                    midiout.sendMessage(&message);
-                    note.noteOffSent = true;
-
-                    // Decrementar contador de notas activas
-                    if (trackStates[i].activeNotes > 0) {
-                        trackStates[i].activeNotes -= 1;
-                    }
-
-                    // Obtener el color de la nota
-                    sf::Color noteColor = setColorByOctaveBlue(note.note);
-
-                    // Remover el color del vector de colores activos
-                    // Busca la primera ocurrencia del color y lo elimina
-                    auto it = std::find(trackStates[i].activeNoteColors.begin(), trackStates[i].activeNoteColors.end(), noteColor);
-                    if (it != trackStates[i].activeNoteColors.end()) {
-                        trackStates[i].activeNoteColors.erase(it);
-                    } else {
-                        std::cerr << "Advertencia: color de nota no encontrado en activeNoteColors para la pista " << i << std::endl;
-                    }
-
-                    // Recalcular el color actual usando la estrategia de mezcla
-                    if (!trackStates[i].activeNoteColors.empty()) {
-                        trackStates[i].currentColor = applyMixingStrategy(trackStates[i].activeNoteColors, mixFunc);
-                    } else {
-                        trackStates[i].currentColor = sf::Color::Black;
-                    }
-
-                    // Actualizar el color del rectángulo
-                    trackRectangles[i].setFillColor(trackStates[i].currentColor);
-                }
+        controls.apply();
+
+        // Reflejar lo que el hilo de envío ya ha enviado
+        sentEvents.clear();
+        dispatcher.drain(sentEvents);
+        for (const TimelineEvent& due : sentEvents) {
+            if (due.noteOn) {
+                startNote(due.track, due.note);
+            } else {
+                stopNote(due.track, due.note);
             }
         }
 
@@ -257,5 +247,8 @@ int main(int argc, char* argv[]) {
         window.display();
     }
 
+    dispatcher.stop();
+    dispatcher.printSendStats(std::cout);
+    midiSink.printPortStats(std::cout);
     return 0;
 }
@@ -6,18 +6,17 @@
 #include <cmath>
 #include <mutex>
 #include <rtmidi/RtMidi.h>
-
-struct NoteEvent {
-    int note;
-    int startTime;
-    int endTime;
-    bool noteOnSent = false;
-    bool noteOffSent = false;
-};
-
-struct Track {
-    std::vector<NoteEvent> notes;
-};
+#include "../crim2sLoader/songFile.h"
+#include "../crim2sLoader/commandLine.h"
+#include "../crim2sLoader/headlessPlayback.h"
+#include "../crim2sLoader/loopRegion.h"
+#include "../crim2sLoader/midiDispatcher.h"
+#include "../crim2sLoader/midiRouter.h"
+#include "../crim2sLoader/playbackControls.h"
+#include "../crim2sLoader/rtMidiSink.h"
+#include "../crim2sLoader/noteScheduler.h"
+#include "../crim2sLoader/tempoMap.h"
+#include "../crim2sLoader/trackFilter.h"
 
 std::mutex noteMutex;
 
@@ -39,147 +38,89 @@ sf::Color setColorByOctaveLinealAbss2(int note) {
     return sf::Color(colors[note % 12][0], colors[note % 12][1], colors[note % 12][2]);
 }
 
-std::vector<Track> readCrim2sFile(const std::string& filename, int& ticksPerBeat) {
-    std::ifstream file(filename);
-    std::vector<Track> tracks;
-    if (!file.is_open()) {
-        std::cerr << "Error al abrir el archivo " << filename << std::endl;
-        return tracks;
-    }
-    std::string line;
-    int totalTracks = 0;
-    // Leer información del encabezado
-    while (std::getline(file, line)) {
-        if (line.find("Ticks per beat:") != std::string::npos) {
-            sscanf(line.c_str(), "Ticks per beat: %d", &ticksPerBeat);
-        } else if (line.find("Número de pistas:") != std::string::npos) {
-            sscanf(line.c_str(), "Número de pistas: %d", &totalTracks);
-            tracks.resize(totalTracks);
-        } else if (line.find("Eventos:") != std::string::npos) {
-            break;
-        }
-    }
+// Agregar el color de la nota al color de la pista
+void addNoteColor(sf::Color& trackColor, int note) {
+    sf::Color noteColor = setColorByOctaveLinealAbss2(note);
+    trackColor.r = std::min(255, trackColor.r + noteColor.r);
+    trackColor.g = std::min(255, trackColor.g + noteColor.g);
+    trackColor.b = std::min(255, trackColor.b + noteColor.b);
+}
 
-    // Leer los eventos
-    while (std::getline(file, line)) {
-        int time = 0, trackIndex = 0;
-        char msgType[16];
-        int channel = 0, note = 0, velocity = 0;
-        if (sscanf(line.c_str(), "Time=%d Track=%d %s", &time, &trackIndex, msgType) >= 3) {
-            if (std::string(msgType) == "note_on" || std::string(msgType) == "note_off") {
-                if (sscanf(line.c_str(), "Time=%d Track=%d %s channel=%d note=%d velocity=%d", 
-                           &time, &trackIndex, msgType, &channel, &note, &velocity) == 6) {
-                    if (trackIndex >= totalTracks) {
-                        std::cerr << "Índice de pista inválido " << trackIndex << std::endl;
-                        continue;
-                    }
-                    if (std::string(msgType) == "note_on" && velocity > 0) {
-                        NoteEvent newNote;
-                        newNote.note = note;
-                        newNote.startTime = time;
-                        newNote.endTime = -1;
-                        tracks[trackIndex].notes.push_back(newNote);
-                    } else {
-                        // Encontrar la nota y establecer endTime
-                        for (auto& n : tracks[trackIndex].notes) {
-                            if (n.note == note && n.endTime == -1) {
-                                n.endTime = time;
-                                break;
-                            }
-                        }
-                    }
-                }
+void processTrack(NoteScheduler& scheduler, int trackIndex, std::int64_t currentTick, sf::Color& trackColor, const TrackFilter& trackFilter) {
+    scheduler.advance(currentTick,
+        // La nota cruza la línea de activación
+        [&](const NoteEvent& note) {
+            if (!trackFilter.audible(trackIndex, note.channel)) {
+                return;
             }
-        }
-    }
+            addNoteColor(trackColor, note.note);
+        },
 
-    // Establecer endTime para notas que no lo tienen
-    int maxTime = 0;
-    for (const auto& track : tracks) {
-        for (const auto& note : track.notes) {
-            if (note.endTime > maxTime) {
-                maxTime = note.endTime;
-            }
-        }
-    }
-    for (auto& track : tracks) {
-        for (auto& note : track.notes) {
-            if (note.endTime == -1) {
-                note.endTime = maxTime;
+        // Termina la duración de la nota
+        [&](const NoteEvent& note) {
+            if (!trackFilter.audible(trackIndex, note.channel)) {
+                return;
             }
-        }
-    }
-
-    file.close();
-    return tracks;
-}
-
-void processTrack(Track& track, int trackIndex, float currentTimeSeconds, float activationLineX, RtMidiOut &midiout, float pixelsPerSecond, float ticksPerSecond, sf::Color& trackColor) {
-    for (auto& note : track.notes) {
-        float noteStartTimeSeconds = note.startTime / ticksPerSecond;
-        float noteEndTimeSeconds = note.endTime / ticksPerSecond;
-
-        // Calcula la posición horizontal de la nota en la pantalla
-        float xPosition = 800 - pixelsPerSecond * (currentTimeSeconds - noteStartTimeSeconds);
-        float durationSeconds = noteEndTimeSeconds - noteStartTimeSeconds;
-        float noteWidth = durationSeconds * pixelsPerSecond;
-
-        // Enviar note_on cuando la nota cruce la línea de activación
-        if (!note.noteOnSent && xPosition <= activationLineX) {
-            std::vector<unsigned char> message = {0x90, static_cast<unsigned char>(note.note), 64};
-            midiout.sendMessage(&message);
-            note.noteOnSent = true;
-
-            // Agregar el color de la nota al color de la pista
-            sf::Color noteColor = setColorByOctaveLinealAbss2(note.note);
-            trackColor.r = std::min(255, trackColor.r + noteColor.r);
-            trackColor.g = std::min(255, trackColor.g + noteColor.g);
-            trackColor.b = std::min(255, trackColor.b + noteColor.b);
-        }
-
-        // Enviar note_off cuando termine la duración de la nota
-        if (!note.noteOffSent && xPosition + noteWidth <= activationLineX) {
-            std::vector<unsigned char> message = {0x80, static_cast<unsigned char>(note.note), 64};
-            midiout.sendMessage(&message);
-            note.noteOffSent = true;
-
             // Restar el color de la nota del color de la pista
             sf::Color noteColor = setColorByOctaveLinealAbss2(note.note);
             trackColor.r = std::max(0, trackColor.r - noteColor.r);
             trackColor.g = std::max(0, trackColor.g - noteColor.g);
             trackColor.b = std::max(0, trackColor.b - noteColor.b);
-        }
-    }
+        });
 }
 
 int main(int argc, char* argv[]) {
+    // --headless: sin ventana ni MIDI, reloj simulado lo más rápido posible
+    bool headless = takeFlag(argc, argv, "--headless");
+
+    // --loop A:B: repite sin fin los compases A a B (o los ticks At:Bt)
+    std::string loopText;
+    bool looping = takeOption(argc, argv, "--loop", loopText);
+
+    // --ports N, --virtual, --routes tabla: reparto de las pistas entre puertos MIDI
+    MidiOutputOptions midiOptions;
+    if (!takeMidiOutputOptions(argc, argv, midiOptions)) {
+        return -1;
+    }
+
     // Verifica que el usuario proporcione el archivo de entrada y los BPM como argumentos
     if (argc != 3) {
-        std::cerr << "Uso: " << argv[0] << " <ruta al archivo .crim2s> <bpm>" << std::endl;
+        printPlaybackUsage(argv[0]);
         return -1;
     }
     std::string crim2sFilePath = argv[1];
     float bpm = std::stof(argv[2]);
 
-    // Inicializa salida MIDI
-    RtMidiOut midiout;
-    unsigned int nPorts = midiout.getPortCount();
-    if (nPorts == 0) {
-        std::cout << "No hay puertos MIDI disponibles.\n";
+    // Sin ventana ni puertos MIDI: se mide antes de abrir nada
+    if (headless) {
+        return runHeadlessFile(crim2sFilePath, bpm);
+    }
+
+    // Abrir los puertos de salida MIDI
+    RtMidiPorts midiPorts;
+    if (!midiPorts.open(midiOptions.ports, midiOptions.virtualPorts)) {
         return -1;
     }
-    midiout.openPort(0);
 
     int ticksPerBeat = 480; // Valor por defecto, se actualizará al leer el archivo
-    std::vector<Track> tracks = readCrim2sFile(crim2sFilePath, ticksPerBeat);
+    std::vector<TempoEvent> tempoEvents;
+    std::vector<Track> tracks = loadSongFile(crim2sFilePath, ticksPerBeat, &tempoEvents);
     if (tracks.empty()) {
         std::cerr << "Error: no se encontraron pistas en el archivo." << std::endl;
         return -1;
     }
 
-    // Calcula ticks por segundo
-    float beatsPerSecond = bpm / 60.0f;
-    float ticksPerSecond = ticksPerBeat * beatsPerSecond;
+    // Mapa de tempo del archivo; los BPM indicados valen hasta el primer set_tempo
+    TempoMap tempoMap(ticksPerBeat, tempoEvents, bpmToMicrosecondsPerBeat(bpm));
+
+    // Bucle A/B opcional
+    LoopRegion loop;
+    if (looping && !parseLoopRegion(loopText, tempoMap, loop)) {
+        return -1;
+    }
+
+    // Un planificador por pista: cada fotograma solo toca las notas que empiezan o terminan
+    std::vector<NoteScheduler> schedulers(tracks.begin(), tracks.end());
 
     // Configura ventana de visualización
     // Ajustamos la altura para mostrar solo la vista transversal
@@ -191,29 +132,97 @@ int main(int argc, char* argv[]) {
     float trackHeight = 150.0f / numTracks; // Ajuste para ajustar la vista transversal
     float pixelsPerSecond = 100.0f; // Este valor ya no afecta la visualización principal
 
-    sf::Clock clock;
     float activationLineX = 200.0f; // Este ya no se utiliza visualmente
     // Eliminamos el vector noteShapes ya que no se dibujan
 
+    // Lo que tarda una nota en llegar desde el borde derecho hasta la línea de activación
+    std::int64_t leadMicros = static_cast<std::int64_t>((800 - activationLineX) / pixelsPerSecond * 1000000.0f);
+
+    // Reloj de reproducción compartido por el envío MIDI y el dibujo
+    PlaybackClock playbackClock;
+
+    MidiRouter midiSink(midiPorts.sinks(), midiOptions.routing);
+
+    // Envío MIDI en su propio hilo, cuando cada nota cruza la línea de activación
+    MidiDispatcher dispatcher(Timeline(tracks), tempoMap, playbackClock, midiSink, leadMicros);
+
     // Variables para la vista transversal
     std::vector<sf::Color> trackColors(numTracks, sf::Color::Black);
 
+    // Silencio y solo en vivo: lo silenciado (pista o canal) no se envía ni se dibuja
+    TrackFilter trackFilter;
+    dispatcher.setTrackFilter(trackFilter);
+    PlaybackControls controls(playbackClock, dispatcher, trackFilter);
+
+    dispatcher.setLoop(loop);
+    if (loop.active()) {
+        for (NoteScheduler& scheduler : schedulers) {
+            scheduler.setLoop(loop.startTick());
+        }
+    }
+    std::int64_t drawnLap = 0; // Vueltas al bucle ya dibujadas
+
+    // Arranca el reloj de la canción y el envío MIDI
+    playbackClock.start();
+    dispatcher.start();
+
     // Bucle principal de la ventana
     while (window.isOpen()) {
         sf::Event event;
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();
+            else if (event.type == sf::Event::KeyPressed) {
+                // Tras un salto o un cambio de silencio
+                if (controls.keyPressed(event.key)) {
+                    // Rehacer los colores con las notas de las pistas audibles en la línea de activación
+                    std::int64_t seekMicros = loop.wrap(playbackClock.micros() - leadMicros, drawnLap);
+                    std::int64_t seekTick = seekMicros < 0 ? -1 : tempoMap.microsToTick(seekMicros);
+                    for (int i = 0; i < numTracks; ++i) {
+                        trackColors[i] = sf::Color::Black;
+                        if (trackFilter.trackAudible(i)) {
+                            schedulers[i].seek(seekTick, [&](const NoteEvent& note) {
+                                if (trackFilter.audible(i, note.channel)) {
+                                    addNoteColor(trackColors[i], note.note);
+                                }
+                            });
+                        }
+                    }
+                }
+            }
         }
-
-        sf::Time elapsed = clock.getElapsedTime();
-        float currentTimeSeconds = elapsed.asSeconds();
+        controls.apply();
+
+        std::int64_t currentMicros = playbackClock.micros();
+
+        // Tick que está cruzando la línea de activación (una conversión por fotograma)
+        std::int64_t lap = 0;
+        std::int64_t songMicros = loop.wrap(currentMicros - leadMicros, lap);
+        if (lap != drawnLap) {
+            // Vuelta del bucle: se suelta todo y se recupera lo que suena en su inicio
+            for (int i = 0; i < numTracks; ++i) {
+                trackColors[i] = sf::Color::Black;
+                if (trackFilter.trackAudible(i)) {
+                    schedulers[i].wrap([&](const NoteEvent& note) {
+                        if (trackFilter.audible(i, note.channel)) {
+                            addNoteColor(trackColors[i], note.note);
+                        }
+                    });
+                }
+            }
+            drawnLap = lap;
+        }
+        std::int64_t currentTick = songMicros < 0 ? -1 : tempoMap.microsToTick(songMicros);
 
         window.clear();
 
-        // Procesa cada pista para actualización de colores y reproducción MIDI
+        // Procesa cada pista para actualización de colores (el MIDI lo envía el dispatcher);
+        // las silenciadas ni se calculan (se rehacen al volver a sonar)
         for (int i = 0; i < numTracks; ++i) {
-            processTrack(tracks[i], i, currentTimeSeconds, activationLineX, midiout, pixelsPerSecond, ticksPerSecond, trackColors[i]);
+            if (!trackFilter.trackAudible(i)) {
+                continue;
+            }
+            processTrack(schedulers[i], i, currentTick, trackColors[i], trackFilter);
         }
 
         // Dibuja la vista transversal en la ventana
@@ -228,5 +237,8 @@ int main(int argc, char* argv[]) {
         window.display(); // Muestra el contenido en la ventana
     }
 
+    dispatcher.stop();
+    dispatcher.printSendStats(std::cout);
+    midiSink.printPortStats(std::cout);
     return 0;
 }
\ No newline at end of file